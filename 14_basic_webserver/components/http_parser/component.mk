@@ -0,0 +1,7 @@
+#
+# Component Makefile
+#
+
+COMPONENT_SRCDIRS := .
+COMPONENT_ADD_INCLUDEDIRS := .
+COMPONENT_PRIV_INCLUDEDIRS := 
\ No newline at end of file
@@ -0,0 +1,120 @@
+/*
+ * Incremental HTTP/1.x request parser and route table
+ *
+ * The parser is fed the received data as it arrives, one netbuf segment at
+ * a time, and doesn't need the whole request in one buffer. Only the path
+ * and the values of the headers the application asks for are copied, the
+ * other headers and the body are skipped.
+ *
+ * Requests are dispatched through a route table, hashed on the path while
+ * it's parsed.
+ */
+
+#ifndef _HTTP_PARSER_H_
+#define _HTTP_PARSER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define HTTP_PARSER_PATH_MAX		64		// path and query, including the terminator
+#define HTTP_PARSER_VALUE_MAX		48		// captured header values, including the terminator
+#define HTTP_PARSER_CAPTURE_MAX		4		// headers captured per request
+#define HTTP_PARSER_NAME_MAX		32		// longest header name that can be captured
+#define HTTP_PARSER_HEADERS_MAX		4096	// bytes of request line and headers
+
+#define HTTP_ROUTER_SLOTS			64		// hash slots, at most half of them used
+
+typedef enum {
+	HTTP_METHOD_UNKNOWN = 0,
+	HTTP_METHOD_GET,
+	HTTP_METHOD_HEAD,
+	HTTP_METHOD_POST,
+	HTTP_METHOD_PUT,
+	HTTP_METHOD_DELETE,
+	HTTP_METHOD_OPTIONS,
+	HTTP_METHOD_ANY,		// routes only: matches every method
+} http_method_t;
+
+typedef enum {
+	HTTP_PARSER_MORE = 0,	// all the data consumed, the request isn't complete
+	HTTP_PARSER_DONE,		// a request is complete, more data may follow
+	HTTP_PARSER_ERROR,		// malformed request, the connection must be closed
+} http_parser_status_t;
+
+typedef enum {
+	HTTP_ERROR_NONE = 0,
+	HTTP_ERROR_BAD_REQUEST,		// 400
+	HTTP_ERROR_URI_TOO_LONG,	// 414
+	HTTP_ERROR_HEADERS_TOO_LARGE,	// 431
+	HTTP_ERROR_VERSION,			// 505
+} http_error_t;
+
+typedef struct {
+	// request, valid when http_parser_feed returned HTTP_PARSER_DONE
+	http_method_t method;
+	char path[HTTP_PARSER_PATH_MAX];	// without the query
+	const char *query;					// after '?' in path's buffer, NULL if none
+	uint8_t version_minor;				// HTTP/1.0 or HTTP/1.1
+	uint8_t keep_alive;					// the connection may be reused
+	uint32_t content_length;
+	uint32_t path_hash;
+	http_error_t error;
+
+	// values of the captured headers, empty if not received
+	const char * const *capture;
+	int capture_count;
+	char values[HTTP_PARSER_CAPTURE_MAX][HTTP_PARSER_VALUE_MAX];
+
+	// parser state
+	uint8_t state;
+	int8_t header;						// captured header of the current line, -1 if none
+	uint8_t builtin;					// Connection or Content-Length line
+	uint16_t pos;
+	uint16_t query_pos;
+	uint32_t header_bytes;
+	uint32_t body_left;
+	char token[HTTP_PARSER_NAME_MAX];
+} http_parser_t;
+
+// a request handler returns 1 if the connection can be reused
+typedef int (*http_handler_t)(http_parser_t *request, void *ctx);
+
+typedef struct {
+	http_method_t method;
+	const char *path;
+	http_handler_t handler;
+} http_route_t;
+
+typedef struct {
+	const http_route_t *routes;
+	int count;
+	http_handler_t fallback;		// called if no route matches
+	uint8_t slots[HTTP_ROUTER_SLOTS];	// route index + 1, 0 if empty
+	uint32_t hashes[HTTP_ROUTER_SLOTS];
+} http_router_t;
+
+// capture: names of the headers whose values are kept, like "If-None-Match"
+void http_parser_init(http_parser_t *parser, const char * const *capture, int capture_count);
+void http_parser_reset(http_parser_t *parser);
+
+// parses up to len bytes, *consumed is set to the bytes used; after
+// HTTP_PARSER_DONE the remaining bytes belong to the next (pipelined) request
+http_parser_status_t http_parser_feed(http_parser_t *parser, const char *data, size_t len, size_t *consumed);
+
+// 1 if part of a request has been received
+int http_parser_started(const http_parser_t *parser);
+
+// value of the n-th captured header, "" if not received
+const char *http_parser_value(const http_parser_t *parser, int n);
+
+// status line of an error, like "400 Bad Request"
+const char *http_parser_error_status(http_error_t error);
+
+uint32_t http_path_hash(const char *path);
+
+// builds the hash table of the routes, returns -1 if there are too many
+int http_router_init(http_router_t *router, const http_route_t *routes, int count, http_handler_t fallback);
+const http_route_t *http_router_find(const http_router_t *router, const http_parser_t *request);
+int http_router_dispatch(const http_router_t *router, http_parser_t *request, void *ctx);
+
+#endif
@@ -4,6 +4,8 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "esp_wifi.h"
 #include "esp_event_loop.h"
 #include "nvs_flash.h"
@@ -16,10 +18,28 @@
 #include "lwip/err.h"
 #include "lwip/netdb.h"
 
+#include "http_parser.h"
+
+
+// HTTP server settings
+#ifdef CONFIG_HTTP_WORKERS
+	#define HTTP_WORKERS CONFIG_HTTP_WORKERS
+#else
+	#define HTTP_WORKERS 4
+#endif
+#ifdef CONFIG_HTTP_MAX_CLIENTS
+	#define HTTP_MAX_CLIENTS CONFIG_HTTP_MAX_CLIENTS
+#else
+	#define HTTP_MAX_CLIENTS 8
+#endif
+#define HTTP_KEEPALIVE_MS 5000
+#define HTTP_POLL_MS 20
+#define HTTP_MAX_REQUESTS 100
 
 // HTTP headers and web pages
-const static char http_html_hdr[] = "HTTP/1.1 200 OK\nContent-type: text/html\n\n";
-const static char http_png_hdr[] = "HTTP/1.1 200 OK\nContent-type: image/png\n\n";
+const static char http_503_hdr[] = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+const static char http_error_hdr[] = "HTTP/1.1 %s\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+const static char http_404_hml[] = "<h1>404 Not Found</h1>";
 const static char http_off_hml[] = "<meta content=\"width=device-width,initial-scale=1\"name=viewport><style>div{width:230px;height:300px;position:absolute;top:0;bottom:0;left:0;right:0;margin:auto}</style><div><h1 align=center>Relay is OFF</h1><a href=on.html><img src=on.png></a></div>";
 const static char http_on_hml[] = "<meta content=\"width=device-width,initial-scale=1\"name=viewport><style>div{width:230px;height:300px;position:absolute;top:0;bottom:0;left:0;right:0;margin:auto}</style><div><h1 align=center>Relay is ON</h1><a href=off.html><img src=off.png></a></div>"; 
 
@@ -37,6 +57,29 @@ const int WIFI_CONNECTED_BIT = BIT0;
 // actual relay status
 bool relay_status;
 
+// accepted connections waiting for a worker, and the bound on connected clients
+static QueueHandle_t conn_queue;
+static SemaphoreHandle_t client_slots;
+
+// per-worker request parsers
+static http_parser_t parsers[HTTP_WORKERS];
+
+// route table, built when the server starts
+static int default_page_handler(http_parser_t *request, void *ctx);
+static int on_page_handler(http_parser_t *request, void *ctx);
+static int off_page_handler(http_parser_t *request, void *ctx);
+static int on_image_handler(http_parser_t *request, void *ctx);
+static int off_image_handler(http_parser_t *request, void *ctx);
+static int not_found_handler(http_parser_t *request, void *ctx);
+const static http_route_t routes[] = {
+	{ HTTP_METHOD_GET, "/", default_page_handler },
+	{ HTTP_METHOD_GET, "/on.html", on_page_handler },
+	{ HTTP_METHOD_GET, "/off.html", off_page_handler },
+	{ HTTP_METHOD_GET, "/on.png", on_image_handler },
+	{ HTTP_METHOD_GET, "/off.png", off_image_handler },
+};
+static http_router_t router;
+
 
 // Wifi event handler
 static esp_err_t event_handler(void *ctx, system_event_t *event)
@@ -62,105 +105,192 @@ static esp_err_t event_handler(void *ctx, system_event_t *event)
 }
 
 	  
-static void http_server_netconn_serve(struct netconn *conn) {
+// send a response, with the headers for a persistent connection
+static void http_send(struct netconn *conn, const char *content_type, const void *body, size_t body_len, int keep_alive) {
+	
+	char header[128];
+	int len = sprintf(header, "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %d\r\nConnection: %s\r\n\r\n",
+		content_type ? "200 OK" : "404 Not Found", content_type ? content_type : "text/html", (int)body_len,
+		keep_alive ? "keep-alive" : "close");
+	netconn_write(conn, header, len, NETCONN_COPY | NETCONN_MORE);
+	
+	// pages and images are constant, no copy needed
+	netconn_write(conn, body, body_len, NETCONN_NOCOPY);
+}
+
+// default page
+static int default_page_handler(http_parser_t *request, void *ctx) {
+	
+	if(relay_status) {
+		printf("Sending default page, relay is ON\n");
+		http_send((struct netconn *)ctx, "text/html", http_on_hml, sizeof(http_on_hml) - 1, request->keep_alive);
+	}
+	else {
+		printf("Sending default page, relay is OFF\n");
+		http_send((struct netconn *)ctx, "text/html", http_off_hml, sizeof(http_off_hml) - 1, request->keep_alive);
+	}
+	return request->keep_alive;
+}
+
+// ON page
+static int on_page_handler(http_parser_t *request, void *ctx) {
+	
+	if(relay_status == false) {
+		printf("Turning relay ON\n");
+		gpio_set_level(CONFIG_RELAY_PIN, 1);
+		relay_status = true;
+	}
+	
+	printf("Sending ON page...\n");
+	http_send((struct netconn *)ctx, "text/html", http_on_hml, sizeof(http_on_hml) - 1, request->keep_alive);
+	return request->keep_alive;
+}
+
+// OFF page
+static int off_page_handler(http_parser_t *request, void *ctx) {
+	
+	if(relay_status == true) {
+		printf("Turning relay OFF\n");
+		gpio_set_level(CONFIG_RELAY_PIN, 0);
+		relay_status = false;
+	}
+	
+	printf("Sending OFF page...\n");
+	http_send((struct netconn *)ctx, "text/html", http_off_hml, sizeof(http_off_hml) - 1, request->keep_alive);
+	return request->keep_alive;
+}
+
+// ON image
+static int on_image_handler(http_parser_t *request, void *ctx) {
+	
+	printf("Sending ON image...\n");
+	http_send((struct netconn *)ctx, "image/png", on_png_start, on_png_end - on_png_start, request->keep_alive);
+	return request->keep_alive;
+}
+
+// OFF image
+static int off_image_handler(http_parser_t *request, void *ctx) {
+	
+	printf("Sending OFF image...\n");
+	http_send((struct netconn *)ctx, "image/png", off_png_start, off_png_end - off_png_start, request->keep_alive);
+	return request->keep_alive;
+}
+
+// any other request
+static int not_found_handler(http_parser_t *request, void *ctx) {
+	
+	printf("Unkown request: %s\n", request->path);
+	http_send((struct netconn *)ctx, NULL, http_404_hml, sizeof(http_404_hml) - 1, request->keep_alive);
+	return request->keep_alive;
+}
+
+// serve the requests of a connection, until it's closed or idle
+static void http_server_netconn_serve(struct netconn *conn, http_parser_t *parser) {
 
 	struct netbuf *inbuf;
-	char *buf;
-	u16_t buflen;
+	int keep_alive = 1;
+	int requests = 0;
+	int idle_ms = 0;
 	err_t err;
 
-	err = netconn_recv(conn, &inbuf);
-
-	if (err == ERR_OK) {
-	  
-		netbuf_data(inbuf, (void**)&buf, &buflen);
-		
-		// extract the first line, with the request
-		char *first_line = strtok(buf, "\n");
+	http_parser_reset(parser);
+	netconn_set_recvtimeout(conn, HTTP_POLL_MS);
+	
+	while(keep_alive) {
 		
-		if(first_line) {
+		err = netconn_recv(conn, &inbuf);
+		if(err == ERR_TIMEOUT) {
 			
-			// default page
-			if(strstr(first_line, "GET / ")) {
-				netconn_write(conn, http_html_hdr, sizeof(http_html_hdr) - 1, NETCONN_NOCOPY);
-				if(relay_status) {
-					printf("Sending default page, relay is ON\n");
-					netconn_write(conn, http_on_hml, sizeof(http_on_hml) - 1, NETCONN_NOCOPY);
-				}					
-				else {
-					printf("Sending default page, relay is OFF\n");
-					netconn_write(conn, http_off_hml, sizeof(http_off_hml) - 1, NETCONN_NOCOPY);
-				}
-			}
-			
-			// ON page
-			else if(strstr(first_line, "GET /on.html ")) {
-				
-				if(relay_status == false) {			
-					printf("Turning relay ON\n");
-					gpio_set_level(CONFIG_RELAY_PIN, 1);
-					relay_status = true;
-				}
+			// an idle connection gives the worker to waiting clients
+			idle_ms += HTTP_POLL_MS;
+			if((!http_parser_started(parser) && uxQueueMessagesWaiting(conn_queue) > 0) || idle_ms >= HTTP_KEEPALIVE_MS) return;
+			continue;
+		}
+		if(err != ERR_OK) return;
+		idle_ms = 0;
+		
+		// parse the received data in place, a request may span more netbufs
+		// and a netbuf may contain more (pipelined) requests
+		do {
+			void *data;
+			u16_t data_len;
+			netbuf_data(inbuf, &data, &data_len);
+			const char *next = data;
+			size_t left = data_len;
+			while(keep_alive && left > 0) {
 				
-				printf("Sending OFF page...\n");
-				netconn_write(conn, http_html_hdr, sizeof(http_html_hdr) - 1, NETCONN_NOCOPY);
-				netconn_write(conn, http_on_hml, sizeof(http_on_hml) - 1, NETCONN_NOCOPY);
-			}			
-
-			// OFF page
-			else if(strstr(first_line, "GET /off.html ")) {
+				size_t consumed;
+				http_parser_status_t status = http_parser_feed(parser, next, left, &consumed);
+				next += consumed;
+				left -= consumed;
 				
-				if(relay_status == true) {			
-					printf("Turning relay OFF\n");
-					gpio_set_level(CONFIG_RELAY_PIN, 0);
-					relay_status = false;
+				if(status == HTTP_PARSER_DONE) {
+					keep_alive = http_router_dispatch(&router, parser, conn) && ++requests < HTTP_MAX_REQUESTS;
+					http_parser_reset(parser);
+				}
+				else if(status == HTTP_PARSER_ERROR) {
+					char response[96];
+					int len = sprintf(response, http_error_hdr, http_parser_error_status(parser->error));
+					netconn_write(conn, response, len, NETCONN_COPY);
+					keep_alive = 0;
 				}
-				
-				printf("Sending OFF page...\n");
-				netconn_write(conn, http_html_hdr, sizeof(http_html_hdr) - 1, NETCONN_NOCOPY);
-				netconn_write(conn, http_off_hml, sizeof(http_off_hml) - 1, NETCONN_NOCOPY);
-			}
-			
-			// ON image
-			else if(strstr(first_line, "GET /on.png ")) {
-				printf("Sending ON image...\n");
-				netconn_write(conn, http_png_hdr, sizeof(http_png_hdr) - 1, NETCONN_NOCOPY);
-				netconn_write(conn, on_png_start, on_png_end - on_png_start, NETCONN_NOCOPY);
-			}
-			
-			// OFF image
-			else if(strstr(first_line, "GET /off.png ")) {
-				printf("Sending OFF image...\n");
-				netconn_write(conn, http_png_hdr, sizeof(http_png_hdr) - 1, NETCONN_NOCOPY);
-				netconn_write(conn, off_png_start, off_png_end - off_png_start, NETCONN_NOCOPY);
 			}
-			
-			else printf("Unkown request: %s\n", first_line);
-		}
-		else printf("Unkown request\n");
+		} while(keep_alive && netbuf_next(inbuf) >= 0);
+		netbuf_delete(inbuf);
 	}
+}
+
+// HTTP worker task, serves the connections from the queue
+static void http_worker(void *pvParameters) {
 	
-	// close the connection and free the buffer
-	netconn_close(conn);
-	netbuf_delete(inbuf);
+	http_parser_t *parser = (http_parser_t *)pvParameters;
+	struct netconn *conn;
+	
+	while(1) {
+		
+		xQueueReceive(conn_queue, &conn, portMAX_DELAY);
+		http_server_netconn_serve(conn, parser);
+		
+		// close the connection and free the client slot
+		netconn_close(conn);
+		netconn_delete(conn);
+		xSemaphoreGive(client_slots);
+	}
 }
 
 static void http_server(void *pvParameters) {
 	
 	struct netconn *conn, *newconn;
 	err_t err;
+	
+	// build the route table and start the workers
+	http_router_init(&router, routes, sizeof(routes) / sizeof(routes[0]), not_found_handler);
+	conn_queue = xQueueCreate(HTTP_MAX_CLIENTS, sizeof(struct netconn *));
+	client_slots = xSemaphoreCreateCounting(HTTP_MAX_CLIENTS, HTTP_MAX_CLIENTS);
+	for(int i = 0; i < HTTP_WORKERS; i++) {
+		http_parser_init(&parsers[i], NULL, 0);
+		xTaskCreate(&http_worker, "http_worker", 3072, &parsers[i], 5, NULL);
+	}
+	
 	conn = netconn_new(NETCONN_TCP);
 	netconn_bind(conn, NULL, 80);
 	netconn_listen(conn);
 	printf("HTTP Server listening...\n");
 	do {
 		err = netconn_accept(conn, &newconn);
-		printf("New client connected\n");
 		if (err == ERR_OK) {
-			http_server_netconn_serve(newconn);
-			netconn_delete(newconn);
+			
+			// too many clients, refuse the connection
+			if(xSemaphoreTake(client_slots, 0) != pdTRUE) {
+				printf("Too many clients\n");
+				netconn_write(newconn, http_503_hdr, sizeof(http_503_hdr) - 1, NETCONN_NOCOPY);
+				netconn_close(newconn);
+				netconn_delete(newconn);
+				continue;
+			}
+			printf("New client connected\n");
+			xQueueSend(conn_queue, &newconn, portMAX_DELAY);
 		}
-		vTaskDelay(1); //allows task to be pre-empted
 	} while(err == ERR_OK);
 	netconn_close(conn);
 	netconn_delete(conn);
@@ -0,0 +1,493 @@
+/*
+ * Incremental HTTP/1.x request parser and route table
+ */
+
+#include <string.h>
+#include <strings.h>
+
+#include "http_parser.h"
+
+// parser states
+enum {
+	S_METHOD = 0,
+	S_PATH,
+	S_VERSION,
+	S_REQUEST_LF,
+	S_LINE_START,
+	S_NAME,
+	S_VALUE_WS,
+	S_VALUE,
+	S_HEADER_LF,
+	S_END_LF,
+	S_BODY,
+	S_DONE,
+	S_ERROR,
+};
+
+// built-in headers
+enum {
+	H_NONE = 0,
+	H_CONNECTION,
+	H_CONTENT_LENGTH,
+};
+
+#define FNV_OFFSET	2166136261u
+#define FNV_PRIME	16777619u
+
+typedef struct {
+	const char *name;
+	http_method_t method;
+} http_method_name_t;
+
+static const http_method_name_t method_names[] = {
+	{ "GET", HTTP_METHOD_GET },
+	{ "HEAD", HTTP_METHOD_HEAD },
+	{ "POST", HTTP_METHOD_POST },
+	{ "PUT", HTTP_METHOD_PUT },
+	{ "DELETE", HTTP_METHOD_DELETE },
+	{ "OPTIONS", HTTP_METHOD_OPTIONS },
+	{ NULL, HTTP_METHOD_UNKNOWN },
+};
+
+// characters allowed in methods and header names (RFC 7230 tchar), lowercase
+static const char tchar_lower[256] = {
+	['!'] = '!', ['#'] = '#', ['$'] = '$', ['%'] = '%', ['&'] = '&', ['\''] = '\'',
+	['*'] = '*', ['+'] = '+', ['-'] = '-', ['.'] = '.', ['^'] = '^', ['_'] = '_',
+	['`'] = '`', ['|'] = '|', ['~'] = '~',
+	['0'] = '0', ['1'] = '1', ['2'] = '2', ['3'] = '3', ['4'] = '4',
+	['5'] = '5', ['6'] = '6', ['7'] = '7', ['8'] = '8', ['9'] = '9',
+	['a'] = 'a', ['b'] = 'b', ['c'] = 'c', ['d'] = 'd', ['e'] = 'e', ['f'] = 'f', ['g'] = 'g',
+	['h'] = 'h', ['i'] = 'i', ['j'] = 'j', ['k'] = 'k', ['l'] = 'l', ['m'] = 'm', ['n'] = 'n',
+	['o'] = 'o', ['p'] = 'p', ['q'] = 'q', ['r'] = 'r', ['s'] = 's', ['t'] = 't', ['u'] = 'u',
+	['v'] = 'v', ['w'] = 'w', ['x'] = 'x', ['y'] = 'y', ['z'] = 'z',
+	['A'] = 'a', ['B'] = 'b', ['C'] = 'c', ['D'] = 'd', ['E'] = 'e', ['F'] = 'f', ['G'] = 'g',
+	['H'] = 'h', ['I'] = 'i', ['J'] = 'j', ['K'] = 'k', ['L'] = 'l', ['M'] = 'm', ['N'] = 'n',
+	['O'] = 'o', ['P'] = 'p', ['Q'] = 'q', ['R'] = 'r', ['S'] = 's', ['T'] = 't', ['U'] = 'u',
+	['V'] = 'v', ['W'] = 'w', ['X'] = 'x', ['Y'] = 'y', ['Z'] = 'z',
+};
+
+#define is_tchar(c)	(tchar_lower[(uint8_t)(c)] != 0)
+
+static char lower(char c) {
+	return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+// end of the line in data[start..len), at the first CR or LF
+static size_t line_end(const char *data, size_t start, size_t len) {
+
+	const char *lf = memchr(data + start, '\n', len - start);
+	size_t end = lf ? (size_t)(lf - data) : len;
+	const char *cr = memchr(data + start, '\r', end - start);
+	return cr ? (size_t)(cr - data) : end;
+}
+
+void http_parser_init(http_parser_t *parser, const char * const *capture, int capture_count) {
+
+	if(capture_count > HTTP_PARSER_CAPTURE_MAX) capture_count = HTTP_PARSER_CAPTURE_MAX;
+	parser->capture = capture;
+	parser->capture_count = capture_count;
+	http_parser_reset(parser);
+}
+
+void http_parser_reset(http_parser_t *parser) {
+
+	parser->method = HTTP_METHOD_UNKNOWN;
+	parser->path[0] = '\0';
+	parser->query = NULL;
+	parser->version_minor = 0;
+	parser->keep_alive = 0;
+	parser->content_length = 0;
+	parser->path_hash = FNV_OFFSET;
+	parser->error = HTTP_ERROR_NONE;
+	for(int i = 0; i < parser->capture_count; i++) parser->values[i][0] = '\0';
+
+	parser->state = S_METHOD;
+	parser->header = -1;
+	parser->builtin = H_NONE;
+	parser->pos = 0;
+	parser->query_pos = 0;
+	parser->header_bytes = 0;
+	parser->body_left = 0;
+}
+
+int http_parser_started(const http_parser_t *parser) {
+
+	return parser->header_bytes > 0;
+}
+
+const char *http_parser_value(const http_parser_t *parser, int n) {
+
+	if(n < 0 || n >= parser->capture_count) return "";
+	return parser->values[n];
+}
+
+const char *http_parser_error_status(http_error_t error) {
+
+	switch(error) {
+		case HTTP_ERROR_URI_TOO_LONG: return "414 URI Too Long";
+		case HTTP_ERROR_HEADERS_TOO_LARGE: return "431 Request Header Fields Too Large";
+		case HTTP_ERROR_VERSION: return "505 HTTP Version Not Supported";
+		default: return "400 Bad Request";
+	}
+}
+
+static http_parser_status_t parser_error(http_parser_t *parser, http_error_t error) {
+
+	parser->state = S_ERROR;
+	parser->error = error;
+	parser->keep_alive = 0;
+	return HTTP_PARSER_ERROR;
+}
+
+// the method is in token
+static void parser_method(http_parser_t *parser) {
+
+	const http_method_name_t *m;
+	for(m = method_names; m->name; m++) {
+		if(strcmp(parser->token, m->name) == 0) break;
+	}
+	parser->method = m->method;
+}
+
+// the version is in token, only HTTP/1.x is supported
+static http_error_t parser_version(http_parser_t *parser) {
+
+	const char *v = parser->token;
+	if(parser->pos != 8 || strncmp(v, "HTTP/", 5) != 0 || v[6] != '.' ||
+			v[5] < '0' || v[5] > '9' || v[7] < '0' || v[7] > '9') {
+		return HTTP_ERROR_BAD_REQUEST;
+	}
+	if(v[5] != '1') return HTTP_ERROR_VERSION;
+
+	// HTTP/1.1 connections are persistent by default
+	parser->version_minor = v[7] - '0';
+	parser->keep_alive = parser->version_minor >= 1;
+	return HTTP_ERROR_NONE;
+}
+
+// the name of a header is in token
+static void parser_header_name(http_parser_t *parser) {
+
+	parser->header = -1;
+	parser->builtin = H_NONE;
+	if(parser->pos >= HTTP_PARSER_NAME_MAX) return;
+
+	// the name is lowercase, the first character rules out most comparisons
+	parser->token[parser->pos] = '\0';
+	if(parser->pos == 10 && memcmp(parser->token, "connection", 10) == 0) parser->builtin = H_CONNECTION;
+	else if(parser->pos == 14 && memcmp(parser->token, "content-length", 14) == 0) parser->builtin = H_CONTENT_LENGTH;
+	for(int i = 0; i < parser->capture_count; i++) {
+		if(tchar_lower[(uint8_t)parser->capture[i][0]] == parser->token[0] && strcasecmp(parser->token, parser->capture[i]) == 0) {
+			parser->header = i;
+			break;
+		}
+	}
+}
+
+// the end of a header value, built-in values are in token
+static http_error_t parser_header_value(http_parser_t *parser) {
+
+	size_t len = parser->pos;
+
+	if(parser->header >= 0) {
+		char *value = parser->values[parser->header];
+		if(len > HTTP_PARSER_VALUE_MAX - 1) len = HTTP_PARSER_VALUE_MAX - 1;
+		while(len > 0 && (value[len - 1] == ' ' || value[len - 1] == '\t')) len--;
+		value[len] = '\0';
+		len = parser->pos;
+	}
+
+	if(parser->builtin != H_NONE) {
+		if(len > HTTP_PARSER_NAME_MAX - 1) len = HTTP_PARSER_NAME_MAX - 1;
+		while(len > 0 && (parser->token[len - 1] == ' ' || parser->token[len - 1] == '\t')) len--;
+		parser->token[len] = '\0';
+
+		if(parser->builtin == H_CONNECTION) {
+			if(strstr(parser->token, "close")) parser->keep_alive = 0;
+			else if(strstr(parser->token, "keep-alive")) parser->keep_alive = 1;
+		}
+		else {
+			// a body length the parser can't skip safely is an error
+			uint32_t length = 0;
+			if(len == 0 || len > 9 || parser->pos > HTTP_PARSER_NAME_MAX - 1) return HTTP_ERROR_BAD_REQUEST;
+			for(size_t i = 0; i < len; i++) {
+				if(parser->token[i] < '0' || parser->token[i] > '9') return HTTP_ERROR_BAD_REQUEST;
+				length = length * 10 + (parser->token[i] - '0');
+			}
+			parser->content_length = length;
+		}
+	}
+	return HTTP_ERROR_NONE;
+}
+
+http_parser_status_t http_parser_feed(http_parser_t *parser, const char *data, size_t len, size_t *consumed) {
+
+	size_t i;
+	http_error_t error;
+
+	for(i = 0; i < len; i++) {
+
+		char c = data[i];
+
+		if(parser->state < S_BODY && ++parser->header_bytes > HTTP_PARSER_HEADERS_MAX) {
+			*consumed = i;
+			return parser_error(parser, HTTP_ERROR_HEADERS_TOO_LARGE);
+		}
+
+		switch(parser->state) {
+
+			case S_METHOD:
+				if(c == ' ' && parser->pos > 0) {
+					parser->token[parser->pos] = '\0';
+					parser_method(parser);
+					parser->state = S_PATH;
+					parser->pos = 0;
+				}
+				// empty lines before a request are ignored
+				else if((c == '\r' || c == '\n') && parser->pos == 0) {
+					parser->header_bytes--;
+				}
+				else if(is_tchar(c) && parser->pos < 8) {
+					parser->token[parser->pos++] = c;
+				}
+				else {
+					*consumed = i;
+					return parser_error(parser, HTTP_ERROR_BAD_REQUEST);
+				}
+				break;
+
+			case S_PATH:
+				if(c == ' ' && parser->pos > 0) {
+					parser->path[parser->pos] = '\0';
+					if(parser->query_pos) parser->query = parser->path + parser->query_pos;
+					parser->state = S_VERSION;
+					parser->pos = 0;
+				}
+				else if((unsigned char)c <= ' ' || c == 0x7f) {
+					*consumed = i;
+					return parser_error(parser, HTTP_ERROR_BAD_REQUEST);
+				}
+				else if(parser->pos >= HTTP_PARSER_PATH_MAX - 1) {
+					*consumed = i;
+					return parser_error(parser, HTTP_ERROR_URI_TOO_LONG);
+				}
+				// the query follows the terminated path
+				else if(c == '?' && !parser->query_pos) {
+					parser->path[parser->pos++] = '\0';
+					parser->query_pos = parser->pos;
+				}
+				else {
+					parser->path[parser->pos++] = c;
+					if(!parser->query_pos) parser->path_hash = (parser->path_hash ^ (uint8_t)c) * FNV_PRIME;
+				}
+				break;
+
+			case S_VERSION:
+				if(c == '\r' || c == '\n') {
+					parser->token[parser->pos < 8 ? parser->pos : 8] = '\0';
+					error = parser_version(parser);
+					if(error != HTTP_ERROR_NONE) {
+						*consumed = i;
+						return parser_error(parser, error);
+					}
+					parser->state = (c == '\r') ? S_REQUEST_LF : S_LINE_START;
+				}
+				else if(parser->pos < 9) {
+					parser->token[parser->pos++] = c;
+				}
+				else {
+					*consumed = i;
+					return parser_error(parser, HTTP_ERROR_BAD_REQUEST);
+				}
+				break;
+
+			case S_REQUEST_LF:
+			case S_HEADER_LF:
+				if(c != '\n') {
+					*consumed = i;
+					return parser_error(parser, HTTP_ERROR_BAD_REQUEST);
+				}
+				parser->state = S_LINE_START;
+				break;
+
+			case S_LINE_START:
+				if(c == '\r') {
+					parser->state = S_END_LF;
+					break;
+				}
+				if(c == '\n') goto headers_end;
+				if(!is_tchar(c)) {
+					// obsolete line folding is rejected too
+					*consumed = i;
+					return parser_error(parser, HTTP_ERROR_BAD_REQUEST);
+				}
+				parser->pos = 0;
+				parser->token[parser->pos++] = tchar_lower[(uint8_t)c];
+				parser->state = S_NAME;
+				break;
+
+			case S_NAME: {
+				char lc = tchar_lower[(uint8_t)c];
+				if(lc) {
+					// the rest of the name in this segment at once
+					size_t end = i;
+					uint16_t pos = parser->pos;
+					do {
+						if(pos < HTTP_PARSER_NAME_MAX - 1) parser->token[pos++] = lc;
+						else pos = HTTP_PARSER_NAME_MAX;		// too long, not captured
+					} while(++end < len && (lc = tchar_lower[(uint8_t)data[end]]));
+					parser->pos = pos;
+					parser->header_bytes += end - i - 1;
+					if(parser->header_bytes > HTTP_PARSER_HEADERS_MAX) {
+						*consumed = i;
+						return parser_error(parser, HTTP_ERROR_HEADERS_TOO_LARGE);
+					}
+					i = end - 1;
+				}
+				else if(c == ':') {
+					parser_header_name(parser);
+					parser->pos = 0;
+					parser->state = S_VALUE_WS;
+				}
+				else {
+					*consumed = i;
+					return parser_error(parser, HTTP_ERROR_BAD_REQUEST);
+				}
+				break;
+			}
+
+			case S_VALUE_WS:
+				if(c == ' ' || c == '\t') break;
+				parser->state = S_VALUE;
+				// fall through
+
+			case S_VALUE: {
+				if(c == '\r' || c == '\n') {
+					error = parser_header_value(parser);
+					if(error != HTTP_ERROR_NONE) {
+						*consumed = i;
+						return parser_error(parser, error);
+					}
+					parser->state = (c == '\r') ? S_HEADER_LF : S_LINE_START;
+					break;
+				}
+
+				// the rest of the value in this segment is handled at once,
+				// most of the request bytes are values nobody looks at
+				size_t end = line_end(data, i + 1, len);
+				size_t run = end - i;
+				parser->header_bytes += run - 1;
+				if(parser->header_bytes > HTTP_PARSER_HEADERS_MAX) {
+					*consumed = i;
+					return parser_error(parser, HTTP_ERROR_HEADERS_TOO_LARGE);
+				}
+				if(parser->header >= 0 && parser->pos < HTTP_PARSER_VALUE_MAX - 1) {
+					size_t n = HTTP_PARSER_VALUE_MAX - 1 - parser->pos;
+					if(n > run) n = run;
+					memcpy(parser->values[parser->header] + parser->pos, data + i, n);
+				}
+				if(parser->builtin != H_NONE) {
+					for(size_t k = 0; k < run && parser->pos + k < HTTP_PARSER_NAME_MAX - 1; k++) {
+						parser->token[parser->pos + k] = lower(data[i + k]);
+					}
+				}
+				parser->pos = (parser->pos + run < 0xffff) ? parser->pos + run : 0xffff;
+				i = end - 1;
+				break;
+			}
+
+			case S_END_LF:
+				if(c != '\n') {
+					*consumed = i;
+					return parser_error(parser, HTTP_ERROR_BAD_REQUEST);
+				}
+			headers_end:
+				if(parser->content_length == 0) {
+					parser->state = S_DONE;
+					*consumed = i + 1;
+					return HTTP_PARSER_DONE;
+				}
+				parser->body_left = parser->content_length;
+				parser->state = S_BODY;
+				break;
+
+			case S_BODY: {
+				// the body is skipped without looking at it
+				size_t skip = len - i;
+				if(skip > parser->body_left) skip = parser->body_left;
+				parser->body_left -= skip;
+				i += skip - 1;
+				if(parser->body_left == 0) {
+					parser->state = S_DONE;
+					*consumed = i + 1;
+					return HTTP_PARSER_DONE;
+				}
+				break;
+			}
+
+			case S_DONE:
+				*consumed = i;
+				return HTTP_PARSER_DONE;
+
+			default:
+				*consumed = i;
+				return HTTP_PARSER_ERROR;
+		}
+	}
+
+	*consumed = len;
+	if(parser->state == S_DONE) return HTTP_PARSER_DONE;
+	if(parser->state == S_ERROR) return HTTP_PARSER_ERROR;
+	return HTTP_PARSER_MORE;
+}
+
+uint32_t http_path_hash(const char *path) {
+
+	uint32_t hash = FNV_OFFSET;
+	while(*path) hash = (hash ^ (uint8_t)*path++) * FNV_PRIME;
+	return hash;
+}
+
+int http_router_init(http_router_t *router, const http_route_t *routes, int count, http_handler_t fallback) {
+
+	if(count > HTTP_ROUTER_SLOTS / 2) return -1;
+
+	router->routes = routes;
+	router->count = count;
+	router->fallback = fallback;
+	memset(router->slots, 0, sizeof(router->slots));
+
+	// open addressing with linear probing
+	for(int i = 0; i < count; i++) {
+		uint32_t hash = http_path_hash(routes[i].path);
+		uint32_t slot = hash & (HTTP_ROUTER_SLOTS - 1);
+		while(router->slots[slot]) slot = (slot + 1) & (HTTP_ROUTER_SLOTS - 1);
+		router->slots[slot] = i + 1;
+		router->hashes[slot] = hash;
+	}
+	return 0;
+}
+
+const http_route_t *http_router_find(const http_router_t *router, const http_parser_t *request) {
+
+	uint32_t hash = request->path_hash;
+	uint32_t slot = hash & (HTTP_ROUTER_SLOTS - 1);
+
+	// routes with the same path and other methods are in the following slots
+	while(router->slots[slot]) {
+		const http_route_t *route = &router->routes[router->slots[slot] - 1];
+		if(router->hashes[slot] == hash && strcmp(route->path, request->path) == 0 &&
+				(route->method == HTTP_METHOD_ANY || route->method == request->method)) {
+			return route;
+		}
+		slot = (slot + 1) & (HTTP_ROUTER_SLOTS - 1);
+	}
+	return NULL;
+}
+
+int http_router_dispatch(const http_router_t *router, http_parser_t *request, void *ctx) {
+
+	const http_route_t *route = http_router_find(router, request);
+	http_handler_t handler = route ? route->handler : router->fallback;
+	return handler ? handler(request, ctx) : 0;
+}
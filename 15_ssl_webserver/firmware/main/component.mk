@@ -1,2 +1,6 @@
 COMPONENT_EMBED_FILES := on.png off.png
 COMPONENT_EMBED_TXTFILES := ca.cer espserver.cer espserver.key
+
+ifdef CONFIG_HTTPS_ECDSA_CERT
+COMPONENT_EMBED_TXTFILES += espserver_ec.cer espserver_ec.key
+endif
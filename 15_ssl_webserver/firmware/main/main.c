@@ -4,6 +4,9 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_system.h"
 #include "esp_wifi.h"
 #include "esp_event_loop.h"
 #include "nvs_flash.h"
@@ -18,6 +21,11 @@
 #include "mbedtls/ctr_drbg.h"
 #include "mbedtls/debug.h"
 #include "mbedtls/error.h"
+#include "mbedtls/ssl_cache.h"
+#include "mbedtls/ssl_ticket.h"
+#include "mbedtls/ssl_ciphersuites.h"
+
+#include "http_parser.h"
 
 
 // mbedTLS error check macro
@@ -32,9 +40,45 @@
 } while (0)
 
 
+// HTTPS server settings
+#ifdef CONFIG_HTTPS_SESSION_CACHE_ENTRIES
+	#define HTTPS_SESSION_CACHE_ENTRIES CONFIG_HTTPS_SESSION_CACHE_ENTRIES
+#else
+	#define HTTPS_SESSION_CACHE_ENTRIES 8
+#endif
+#ifdef CONFIG_HTTPS_SESSION_LIFETIME
+	#define HTTPS_SESSION_LIFETIME CONFIG_HTTPS_SESSION_LIFETIME
+#else
+	#define HTTPS_SESSION_LIFETIME 3600
+#endif
+#ifdef CONFIG_HTTPS_MAX_CONNECTIONS
+	#define HTTPS_MAX_CONNECTIONS CONFIG_HTTPS_MAX_CONNECTIONS
+#else
+	#define HTTPS_MAX_CONNECTIONS 2
+#endif
+#if defined(CONFIG_HTTPS_RECORD_SIZE_512)
+	#define HTTPS_MAX_FRAG_LEN MBEDTLS_SSL_MAX_FRAG_LEN_512
+#elif defined(CONFIG_HTTPS_RECORD_SIZE_1024)
+	#define HTTPS_MAX_FRAG_LEN MBEDTLS_SSL_MAX_FRAG_LEN_1024
+#elif defined(CONFIG_HTTPS_RECORD_SIZE_2048)
+	#define HTTPS_MAX_FRAG_LEN MBEDTLS_SSL_MAX_FRAG_LEN_2048
+#elif defined(CONFIG_HTTPS_RECORD_SIZE_4096)
+	#define HTTPS_MAX_FRAG_LEN MBEDTLS_SSL_MAX_FRAG_LEN_4096
+#else
+	#define HTTPS_MAX_FRAG_LEN MBEDTLS_SSL_MAX_FRAG_LEN_NONE
+#endif
+#define HTTPS_BACKLOG 8
+#define HTTPS_WORKER_STACK 10000
+#define HTTPS_HANDSHAKE_TIMEOUT_MS 30000
+#define HTTP_KEEPALIVE_MS 5000
+#define HTTP_POLL_MS 100
+#define HTTP_MAX_REQUESTS 100
+#define HTTP_RESPONSE_BUFFER_SIZE 1024
+
 // HTTP headers and web pages
-const static unsigned char http_html_hdr[] = "HTTP/1.1 200 OK\nContent-type: text/html\n\n";
-const static unsigned char http_png_hdr[] = "HTTP/1.1 200 OK\nContent-type: image/png\n\n";
+const static char http_hdr[] = "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %d\r\nConnection: %s\r\n\r\n";
+const static char http_error_hdr[] = "HTTP/1.1 %s\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+const static unsigned char http_404_hml[] = "<h1>404 Not Found</h1>";
 const static unsigned char http_off_hml[] = "<meta content=\"width=device-width,initial-scale=1\"name=viewport><style>div{width:230px;height:300px;position:absolute;top:0;bottom:0;left:0;right:0;margin:auto}</style><div><h1 align=center>Relay is OFF</h1><a href=on.html><img src=on.png></a></div>";
 const static unsigned char http_on_hml[] = "<meta content=\"width=device-width,initial-scale=1\"name=viewport><style>div{width:230px;height:300px;position:absolute;top:0;bottom:0;left:0;right:0;margin:auto}</style><div><h1 align=center>Relay is ON</h1><a href=off.html><img src=off.png></a></div>"; 
 
@@ -45,6 +89,12 @@ extern const uint8_t espserver_cer_start[]  asm("_binary_espserver_cer_start");
 extern const uint8_t espserver_cer_end[]    asm("_binary_espserver_cer_end");
 extern const uint8_t espserver_key_start[]  asm("_binary_espserver_key_start");
 extern const uint8_t espserver_key_end[]    asm("_binary_espserver_key_end");
+#ifdef CONFIG_HTTPS_ECDSA_CERT
+extern const uint8_t espserver_ec_cer_start[] asm("_binary_espserver_ec_cer_start");
+extern const uint8_t espserver_ec_cer_end[]   asm("_binary_espserver_ec_cer_end");
+extern const uint8_t espserver_ec_key_start[] asm("_binary_espserver_ec_key_start");
+extern const uint8_t espserver_ec_key_end[]   asm("_binary_espserver_ec_key_end");
+#endif
 extern const uint8_t on_png_start[] 		asm("_binary_on_png_start");
 extern const uint8_t on_png_end[]   		asm("_binary_on_png_end");
 extern const uint8_t off_png_start[] 		asm("_binary_off_png_start");
@@ -53,13 +103,80 @@ extern const uint8_t off_png_end[]   		asm("_binary_off_png_end");
 
 // mbed TLS variables
 mbedtls_ssl_config conf;
-mbedtls_ssl_context ssl;
-mbedtls_net_context listen_fd, client_fd;
+mbedtls_net_context listen_fd;
 mbedtls_entropy_context entropy;
 mbedtls_ctr_drbg_context ctr_drbg;
 mbedtls_x509_crt srvcert;
 mbedtls_x509_crt cachain;
 mbedtls_pk_context pkey;
+#ifdef CONFIG_HTTPS_ECDSA_CERT
+mbedtls_x509_crt srvcert_ec;
+mbedtls_pk_context pkey_ec;
+#endif
+#if defined(MBEDTLS_SSL_CACHE_C)
+mbedtls_ssl_cache_context cache;
+#endif
+#if defined(MBEDTLS_SSL_TICKET_C)
+mbedtls_ssl_ticket_context ticket_ctx;
+#endif
+
+// cipher suites in order of preference: the ECDSA key exchange is the
+// cheapest on the ESP32, then RSA key exchange, with a single RSA operation
+const static int preferred_ciphersuites[] = {
+	MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256,
+	MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_CBC_SHA256,
+	MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_CBC_SHA,
+	MBEDTLS_TLS_RSA_WITH_AES_128_GCM_SHA256,
+	MBEDTLS_TLS_RSA_WITH_AES_128_CBC_SHA256,
+	MBEDTLS_TLS_RSA_WITH_AES_128_CBC_SHA,
+	MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256,
+	MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_CBC_SHA256,
+	MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_CBC_SHA,
+};
+static int ciphersuites[sizeof(preferred_ciphersuites) / sizeof(preferred_ciphersuites[0]) + 1];
+
+// curves for ECDHE, the ones with the fastest implementation
+const static mbedtls_ecp_group_id curves[] = {
+	MBEDTLS_ECP_DP_CURVE25519,
+	MBEDTLS_ECP_DP_SECP256R1,
+	MBEDTLS_ECP_DP_NONE,
+};
+
+// handshake statistics, full and resumed
+static uint32_t handshake_count[2];
+static uint32_t handshake_ms[2];
+
+// a connection slot, set up once and reused for every client so the
+// memory used by the server is allocated when it starts
+typedef struct {
+	mbedtls_ssl_context ssl;
+	mbedtls_net_context client_fd;
+	http_parser_t parser;
+	unsigned char response[HTTP_RESPONSE_BUFFER_SIZE];
+} https_conn_t;
+static https_conn_t conns[HTTPS_MAX_CONNECTIONS];
+
+// accepted clients waiting for a free slot
+static QueueHandle_t conn_queue;
+
+// the random generator, the session cache and the ticket keys are shared by the slots
+static SemaphoreHandle_t tls_mutex;
+
+// request parser and route table
+static int default_page_handler(http_parser_t *request, void *ctx);
+static int on_page_handler(http_parser_t *request, void *ctx);
+static int off_page_handler(http_parser_t *request, void *ctx);
+static int on_image_handler(http_parser_t *request, void *ctx);
+static int off_image_handler(http_parser_t *request, void *ctx);
+static int not_found_handler(http_parser_t *request, void *ctx);
+const static http_route_t routes[] = {
+	{ HTTP_METHOD_GET, "/", default_page_handler },
+	{ HTTP_METHOD_GET, "/on.html", on_page_handler },
+	{ HTTP_METHOD_GET, "/off.html", off_page_handler },
+	{ HTTP_METHOD_GET, "/on.png", on_image_handler },
+	{ HTTP_METHOD_GET, "/off.png", off_image_handler },
+};
+static http_router_t router;
 
 // Event group for inter-task communication
 static EventGroupHandle_t event_group;
@@ -126,37 +243,203 @@ static esp_err_t event_handler(void *ctx, system_event_t *event)
 }
 
 	  
-static void https_serve(mbedtls_net_context *client_fd) {
+// send a response, the headers and a short body go in the same TLS record
+static int http_send(https_conn_t *conn, const char *status, const char *content_type, const unsigned char *body, size_t body_len, int keep_alive) {
+	
+	int len = sprintf((char *)conn->response, http_hdr, status, content_type, (int)body_len, keep_alive ? "keep-alive" : "close");
+	
+	if(body_len <= sizeof(conn->response) - len) {
+		memcpy(conn->response + len, body, body_len);
+		return ssl_write(&conn->ssl, conn->response, len + body_len);
+	}
+	if(ssl_write(&conn->ssl, conn->response, len) != 0) return -1;
+	return ssl_write(&conn->ssl, body, body_len);
+}
+
+// default page
+static int default_page_handler(http_parser_t *request, void *ctx) {
 	
-	// return variable
 	int ret;
+	if(relay_status) {
+		printf("* sending default page, relay is ON\n");
+		ret = http_send((https_conn_t *)ctx, "200 OK", "text/html", http_on_hml, sizeof(http_on_hml) - 1, request->keep_alive);
+	}
+	else {
+		printf("* sending default page, relay is OFF\n");
+		ret = http_send((https_conn_t *)ctx, "200 OK", "text/html", http_off_hml, sizeof(http_off_hml) - 1, request->keep_alive);
+	}
+	return ret == 0 && request->keep_alive;
+}
+
+// ON page
+static int on_page_handler(http_parser_t *request, void *ctx) {
 	
-	// initialize SSL context
-	mbedtls_ssl_init(&ssl);
-	MBEDTLS_ERR(mbedtls_ssl_setup(&ssl, &conf));
-	//printf("SSL initialized\n");
+	if(relay_status == false) {
+		printf("* turning relay ON\n");
+		gpio_set_level(CONFIG_RELAY_PIN, 1);
+		relay_status = true;
+	}
 	
-	// configure the input and output functions
-	mbedtls_ssl_set_bio(&ssl, client_fd, mbedtls_net_send, mbedtls_net_recv, NULL);
+	printf("* sending ON page...\n");
+	int ret = http_send((https_conn_t *)ctx, "200 OK", "text/html", http_on_hml, sizeof(http_on_hml) - 1, request->keep_alive);
+	return ret == 0 && request->keep_alive;
+}
+
+// OFF page
+static int off_page_handler(http_parser_t *request, void *ctx) {
+	
+	if(relay_status == true) {
+		printf("* turning relay OFF\n");
+		gpio_set_level(CONFIG_RELAY_PIN, 0);
+		relay_status = false;
+	}
+	
+	printf("* sending OFF page...\n");
+	int ret = http_send((https_conn_t *)ctx, "200 OK", "text/html", http_off_hml, sizeof(http_off_hml) - 1, request->keep_alive);
+	return ret == 0 && request->keep_alive;
+}
+
+// ON image
+static int on_image_handler(http_parser_t *request, void *ctx) {
+	
+	printf("* sending ON image...\n");
+	int ret = http_send((https_conn_t *)ctx, "200 OK", "image/png", on_png_start, on_png_end - on_png_start, request->keep_alive);
+	return ret == 0 && request->keep_alive;
+}
+
+// OFF image
+static int off_image_handler(http_parser_t *request, void *ctx) {
+	
+	printf("* sending OFF image...\n");
+	int ret = http_send((https_conn_t *)ctx, "200 OK", "image/png", off_png_start, off_png_end - off_png_start, request->keep_alive);
+	return ret == 0 && request->keep_alive;
+}
+
+// any other request
+static int not_found_handler(http_parser_t *request, void *ctx) {
+	
+	printf("* unkown request: %s\n", request->path);
+	int ret = http_send((https_conn_t *)ctx, "404 Not Found", "text/html", http_404_hml, sizeof(http_404_hml) - 1, request->keep_alive);
+	return ret == 0 && request->keep_alive;
+}
+
+// random generator for the connections, locked
+static int tls_random(void *ctx, unsigned char *output, size_t len) {
+	
+	xSemaphoreTake(tls_mutex, portMAX_DELAY);
+	int ret = mbedtls_ctr_drbg_random(ctx, output, len);
+	xSemaphoreGive(tls_mutex);
+	return ret;
+}
+
+#if defined(MBEDTLS_SSL_CACHE_C)
+// session cache callbacks, locked
+static int session_cache_get(void *data, mbedtls_ssl_session *session) {
+	
+	xSemaphoreTake(tls_mutex, portMAX_DELAY);
+	int ret = mbedtls_ssl_cache_get(data, session);
+	xSemaphoreGive(tls_mutex);
+	return ret;
+}
+
+static int session_cache_set(void *data, const mbedtls_ssl_session *session) {
+	
+	xSemaphoreTake(tls_mutex, portMAX_DELAY);
+	int ret = mbedtls_ssl_cache_set(data, session);
+	xSemaphoreGive(tls_mutex);
+	return ret;
+}
+#endif
+
+#if defined(MBEDTLS_SSL_TICKET_C)
+// session ticket callbacks, locked (the ticket keys are renewed when they expire)
+static int session_ticket_write(void *p_ticket, const mbedtls_ssl_session *session, unsigned char *start, const unsigned char *end, size_t *tlen, uint32_t *lifetime) {
+	
+	xSemaphoreTake(tls_mutex, portMAX_DELAY);
+	int ret = mbedtls_ssl_ticket_write(p_ticket, session, start, end, tlen, lifetime);
+	xSemaphoreGive(tls_mutex);
+	return ret;
+}
+
+static int session_ticket_parse(void *p_ticket, mbedtls_ssl_session *session, unsigned char *buf, size_t len) {
+	
+	xSemaphoreTake(tls_mutex, portMAX_DELAY);
+	int ret = mbedtls_ssl_ticket_parse(p_ticket, session, buf, len);
+	xSemaphoreGive(tls_mutex);
+	return ret;
+}
+#endif
+
+// perform the handshake and print its duration, returns 0 if successful
+static int https_handshake(mbedtls_ssl_context *ssl) {
+	
+	int ret;
+	TickType_t start = xTaskGetTickCount();
+	
+	// a resumed session goes from the ServerHello to ChangeCipherSpec,
+	// without the certificates and the key exchange
+	int full = 0;
+	while(ssl->state != MBEDTLS_SSL_HANDSHAKE_OVER) {
+		
+		if(ssl->state == MBEDTLS_SSL_SERVER_CERTIFICATE) full = 1;
+		ret = mbedtls_ssl_handshake_step(ssl);
+		if(ret == 0 || ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) continue;
+		
+		// the read timeout is short for the keep-alive polling, the handshake
+		// waits longer (the browser may ask the user for the client certificate)
+		if(ret == MBEDTLS_ERR_SSL_TIMEOUT && (xTaskGetTickCount() - start) * portTICK_RATE_MS < HTTPS_HANDSHAKE_TIMEOUT_MS) continue;
+		
+		char errdesc[100];
+		mbedtls_strerror(ret, errdesc, 100);
+		printf("* handshake failed: %s (-0x%04x)\n", errdesc, -ret);
+		return ret;
+	}
+	
+	uint32_t ms = (xTaskGetTickCount() - start) * portTICK_RATE_MS;
+	xSemaphoreTake(tls_mutex, portMAX_DELAY);
+	handshake_count[!full]++;
+	handshake_ms[!full] += ms;
+	uint32_t average = handshake_ms[!full] / handshake_count[!full];
+	uint32_t count = handshake_count[!full];
+	xSemaphoreGive(tls_mutex);
+	printf("* %s handshake (%s) in %u ms, average %u ms over %u\n", full ? "full" : "resumed",
+		mbedtls_ssl_get_ciphersuite(ssl), (unsigned int)ms, (unsigned int)average, (unsigned int)count);
+	return 0;
+}
+
+// serve the requests of a client over one TLS session, until it's closed or idle
+static void https_serve(https_conn_t *conn) {
+	
+	// return variable
+	int ret;
+	
+	// configure the input and output functions, reads time out to poll for other clients
+	mbedtls_ssl_set_bio(&conn->ssl, &conn->client_fd, mbedtls_net_send, NULL, mbedtls_net_recv_timeout);
 	
 	// handshake
-	while((ret = mbedtls_ssl_handshake(&ssl)) != 0)
-		if(ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
-			char errdesc[100];
-			mbedtls_strerror(ret, errdesc, 100);
-			goto serve_exit;
-		};
+	if(https_handshake(&conn->ssl) != 0) goto serve_exit;
 	//printf("Handshake performed\n");
 	
-	// read the request from the client
+	// read the requests from the client, pipelined requests are answered in order
 	unsigned char buf[1024];
-	do {
-		int len = sizeof(buf) - 1;
-		memset(buf, 0, sizeof(buf));
-		ret = mbedtls_ssl_read(&ssl, buf, len);
+	int keep_alive = 1;
+	int requests = 0;
+	int idle_ms = 0;
+	http_parser_reset(&conn->parser);
+	while(keep_alive) {
+		
+		ret = mbedtls_ssl_read(&conn->ssl, buf, sizeof(buf));
 		if(ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) continue;
+		
+		// an idle connection gives the slot to waiting clients
+		if(ret == MBEDTLS_ERR_SSL_TIMEOUT) {
+			idle_ms += HTTP_POLL_MS;
+			if((!http_parser_started(&conn->parser) && uxQueueMessagesWaiting(conn_queue) > 0) || idle_ms >= HTTP_KEEPALIVE_MS) break;
+			continue;
+		}
 		if(ret <= 0) switch(ret) {
 		
+			case 0:
 			case MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY:
 				printf("* peer closed connection gracefully\n");
 				goto serve_exit;
@@ -166,93 +449,60 @@ static void https_serve(mbedtls_net_context *client_fd) {
 				goto serve_exit;
 				
 			default:
-				printf("* mbedtls_ssl_read returned -0x%04x\n", ret);
+				printf("* mbedtls_ssl_read returned -0x%04x\n", -ret);
 				goto serve_exit;
 		}
-
-		if(ret > 0) break;
-	} while(1);
-	
-	buf[ret] = '\0';
-	
-	// extract the first line, with the request
-	char *first_line = strtok((char *)buf, "\n");
-	
-	if(first_line) {
-		
-		// default page
-		if(strstr(first_line, "GET / ")) {
-			mbedtls_ssl_write(&ssl, http_html_hdr, sizeof(http_html_hdr) - 1);
-			if(relay_status) {
-				printf("* sending default page, relay is ON\n");
-				mbedtls_ssl_write(&ssl, http_on_hml, sizeof(http_on_hml) - 1);
-			}					
-			else {
-				printf("* sending default page, relay is OFF\n");
-				mbedtls_ssl_write(&ssl, http_off_hml, sizeof(http_off_hml) - 1);
-			}
-		}
+		idle_ms = 0;
 		
-		// ON page
-		else if(strstr(first_line, "GET /on.html ")) {
+		const char *next = (const char *)buf;
+		size_t left = ret;
+		while(keep_alive && left > 0) {
 			
-			if(relay_status == false) {			
-				printf("* turning relay ON\n");
-				gpio_set_level(CONFIG_RELAY_PIN, 1);
-				relay_status = true;
-			}
-			
-			printf("* sending OFF page...\n");
-			mbedtls_ssl_write(&ssl, http_html_hdr, sizeof(http_html_hdr) - 1);
-			mbedtls_ssl_write(&ssl, http_on_hml, sizeof(http_on_hml) - 1);
-		}			
-
-		// OFF page
-		else if(strstr(first_line, "GET /off.html ")) {
+			size_t consumed;
+			http_parser_status_t status = http_parser_feed(&conn->parser, next, left, &consumed);
+			next += consumed;
+			left -= consumed;
 			
-			if(relay_status == true) {			
-				printf("* turning relay OFF\n");
-				gpio_set_level(CONFIG_RELAY_PIN, 0);
-				relay_status = false;
+			if(status == HTTP_PARSER_DONE) {
+				keep_alive = http_router_dispatch(&router, &conn->parser, conn) && ++requests < HTTP_MAX_REQUESTS;
+				http_parser_reset(&conn->parser);
+			}
+			else if(status == HTTP_PARSER_ERROR) {
+				int len = sprintf((char *)conn->response, http_error_hdr, http_parser_error_status(conn->parser.error));
+				ssl_write(&conn->ssl, conn->response, len);
+				keep_alive = 0;
 			}
-			
-			printf("* sending OFF page...\n");
-			mbedtls_ssl_write(&ssl, http_html_hdr, sizeof(http_html_hdr) - 1);
-			mbedtls_ssl_write(&ssl, http_off_hml, sizeof(http_off_hml) - 1);
-		}
-		
-		// ON image
-		else if(strstr(first_line, "GET /on.png ")) {
-			printf("* sending ON image...\n");
-			ssl_write(&ssl, http_png_hdr, sizeof(http_png_hdr) - 1);
-			ssl_write(&ssl, on_png_start, on_png_end - on_png_start);
-		}
-		
-		// OFF image
-		else if(strstr(first_line, "GET /off.png ")) {
-			printf("* sending OFF image...\n");
-			ssl_write(&ssl, http_png_hdr, sizeof(http_png_hdr) - 1);
-			ssl_write(&ssl, off_png_start, off_png_end - off_png_start);
 		}
-		
-		else printf("* unkown request: %s\n", first_line);
 	}
-	else printf("* unknown request\n");
+	printf("* %d requests served\n", requests);
 	
-	// close the connection and free the buffer
+	// close the connection
 	serve_exit:
-	mbedtls_ssl_close_notify(&ssl);
-	mbedtls_net_free(client_fd);
-	mbedtls_ssl_free(&ssl);
+	mbedtls_ssl_close_notify(&conn->ssl);
+	mbedtls_net_free(&conn->client_fd);
 	printf("\n");
 }
 
+// HTTPS worker task, serves the clients from the queue with its connection slot
+static void https_worker(void *pvParameters) {
+	
+	https_conn_t *conn = (https_conn_t *)pvParameters;
+	
+	while(1) {
+		
+		xQueueReceive(conn_queue, &conn->client_fd.fd, portMAX_DELAY);
+		https_serve(conn);
+		
+		// ready for the next client, the buffers are kept
+		mbedtls_ssl_session_reset(&conn->ssl);
+	}
+}
+
 
 static void https_server(void *pvParameters) {
 	
 	// initialize mbedTLS components
 	mbedtls_net_init(&listen_fd);
-	mbedtls_net_init(&client_fd);
 	mbedtls_ssl_config_init(&conf);
 	mbedtls_ctr_drbg_init(&ctr_drbg);
 	mbedtls_entropy_init(&entropy);	
@@ -264,6 +514,12 @@ static void https_server(void *pvParameters) {
 	MBEDTLS_ERR(mbedtls_x509_crt_parse(&cachain, ca_cer_start, ca_cer_end - ca_cer_start));
 	MBEDTLS_ERR(mbedtls_x509_crt_parse(&srvcert, espserver_cer_start, espserver_cer_end - espserver_cer_start));
 	MBEDTLS_ERR(mbedtls_pk_parse_key(&pkey, espserver_key_start, espserver_key_end - espserver_key_start, NULL, 0));
+#ifdef CONFIG_HTTPS_ECDSA_CERT
+	mbedtls_x509_crt_init(&srvcert_ec);
+	mbedtls_pk_init(&pkey_ec);
+	MBEDTLS_ERR(mbedtls_x509_crt_parse(&srvcert_ec, espserver_ec_cer_start, espserver_ec_cer_end - espserver_ec_cer_start));
+	MBEDTLS_ERR(mbedtls_pk_parse_key(&pkey_ec, espserver_ec_key_start, espserver_ec_key_end - espserver_ec_key_start, NULL, 0));
+#endif
 
 	// seed the random number generator
 	MBEDTLS_ERR(mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy, NULL, 0));
@@ -272,30 +528,81 @@ static void https_server(void *pvParameters) {
 	MBEDTLS_ERR(mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_SERVER,	MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT));
 	
 	// apply the configuration to the random engine and set the debug function
-	mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &ctr_drbg);
+	tls_mutex = xSemaphoreCreateMutex();
+	mbedtls_ssl_conf_rng(&conf, tls_random, &ctr_drbg);
 	mbedtls_ssl_conf_dbg(&conf, my_mbedtls_debug, NULL);
 	
-	// configure CA chain and server certificate
+	// configure CA chain and server certificates, mbedTLS picks the one
+	// matching the negotiated cipher suite
 	mbedtls_ssl_conf_ca_chain(&conf, &cachain, NULL);
+#ifdef CONFIG_HTTPS_ECDSA_CERT
+	MBEDTLS_ERR(mbedtls_ssl_conf_own_cert(&conf, &srvcert_ec, &pkey_ec));
+#endif
 	MBEDTLS_ERR(mbedtls_ssl_conf_own_cert(&conf, &srvcert, &pkey));
 	
 	// require client authentication
 	mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_REQUIRED);
 	
+	// cipher suites and curves, skipping the ones not enabled in mbedTLS
+	int count = 0;
+	for(int i = 0; i < sizeof(preferred_ciphersuites) / sizeof(preferred_ciphersuites[0]); i++) {
+		if(mbedtls_ssl_ciphersuite_from_id(preferred_ciphersuites[i]) != NULL) ciphersuites[count++] = preferred_ciphersuites[i];
+	}
+	ciphersuites[count] = 0;
+	mbedtls_ssl_conf_ciphersuites(&conf, ciphersuites);
+	mbedtls_ssl_conf_curves(&conf, curves);
+	
+	// resume the sessions of returning clients, with the session ID...
+#if defined(MBEDTLS_SSL_CACHE_C)
+	mbedtls_ssl_cache_init(&cache);
+	mbedtls_ssl_cache_set_max_entries(&cache, HTTPS_SESSION_CACHE_ENTRIES);
+	mbedtls_ssl_cache_set_timeout(&cache, HTTPS_SESSION_LIFETIME);
+	mbedtls_ssl_conf_session_cache(&conf, &cache, session_cache_get, session_cache_set);
+#endif
+	
+	// ...or with a session ticket, kept by the client
+#if defined(MBEDTLS_SSL_TICKET_C)
+	mbedtls_ssl_ticket_init(&ticket_ctx);
+	MBEDTLS_ERR(mbedtls_ssl_ticket_setup(&ticket_ctx, mbedtls_ctr_drbg_random, &ctr_drbg, MBEDTLS_CIPHER_AES_256_GCM, HTTPS_SESSION_LIFETIME));
+	mbedtls_ssl_conf_session_tickets_cb(&conf, session_ticket_write, session_ticket_parse, &ticket_ctx);
+#endif
+	
+	// limit the size of the records sent, and accept the limit asked by the client
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+	MBEDTLS_ERR(mbedtls_ssl_conf_max_frag_len(&conf, HTTPS_MAX_FRAG_LEN));
+#endif
+	
+	// reads time out, so an idle keep-alive connection can give way to other clients
+	mbedtls_ssl_conf_read_timeout(&conf, HTTP_POLL_MS);
+	http_router_init(&router, routes, sizeof(routes) / sizeof(routes[0]), not_found_handler);
+	
 	printf("- mbedTLS configured\n");
 	
+	// set up the connection slots, each mbedTLS context allocates its record buffers here
+	uint32_t heap = esp_get_free_heap_size();
+	conn_queue = xQueueCreate(HTTPS_BACKLOG, sizeof(int));
+	for(int i = 0; i < HTTPS_MAX_CONNECTIONS; i++) {
+		mbedtls_ssl_init(&conns[i].ssl);
+		MBEDTLS_ERR(mbedtls_ssl_setup(&conns[i].ssl, &conf));
+		mbedtls_net_init(&conns[i].client_fd);
+		http_parser_init(&conns[i].parser, NULL, 0);
+		xTaskCreate(&https_worker, "https_worker", HTTPS_WORKER_STACK, &conns[i], 5, NULL);
+	}
+	heap -= esp_get_free_heap_size();
+	printf("- %d connection slots, %u bytes of heap (%u per connection)\n", HTTPS_MAX_CONNECTIONS,
+		(unsigned int)heap, (unsigned int)(heap / HTTPS_MAX_CONNECTIONS));
+	
 	// bind to the default port (443)
 	MBEDTLS_ERR(mbedtls_net_bind(&listen_fd, NULL, "443", MBEDTLS_NET_PROTO_TCP));
 	printf("- bind on port 443 completed\n\n");
 	printf("HTTPS Server ready!\n\n");
 	
-	// accept incoming connections
+	// accept incoming connections, they wait in the queue while all the slots are busy
+	mbedtls_net_context client_fd;
 	while(1) {
 		MBEDTLS_ERR(mbedtls_net_accept(&listen_fd, &client_fd, NULL, 0, NULL));
 		printf("* new client connected\n");
-		
-		// serve the connection
-		https_serve(&client_fd);
+		xQueueSend(conn_queue, &client_fd.fd, portMAX_DELAY);
 	}
 }
 
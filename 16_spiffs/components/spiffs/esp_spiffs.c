@@ -28,6 +28,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "esp_spiffs.h"
 #include "esp_attr.h"
@@ -36,103 +37,182 @@
 
 #include <esp_spi_flash.h>
 
+/*
+ * spi_flash_read / spi_flash_write need a 4 byte aligned flash address,
+ * size and RAM buffer. No heap memory is used for unaligned accesses:
+ *
+ * - Accesses, which fit into the scratch arena after alignment (all small
+ *   lookup and header accesses of SPIFFS), use one flash operation on the
+ *   aligned range in the scratch arena.
+ * - Larger accesses are split into head, body and tail. The aligned body is
+ *   read / written directly from / to the caller's buffer if it is aligned,
+ *   otherwise in chunks through the scratch arena. Head and tail are
+ *   handled with a single word.
+ *
+ * Writes do not need a read-modify-write: the padding bytes are 0xff, which
+ * does not change the flash content.
+ * The scratch arena is shared, this is safe because SPIFFS calls these
+ * functions with the SPIFFS_LOCK mutex held.
+ */
+#define FLASH_ALIGN(x)      ((x) & (u32_t)-4)
+#define FLASH_IS_ALIGNED(x) (((x) & 3) == 0)
+#define FLASH_SECTOR_SIZE   4096
+
+static u32_t flash_scratch[ESP_SPIFFS_SCRATCH_SIZE / 4];
+
 s32_t IRAM_ATTR esp32_spi_flash_read(u32_t addr, u32_t size, u8_t *dst) {
 	u32_t aaddr;
-	u8_t *buff = NULL;
-	u8_t *abuff = NULL;
 	u32_t asize;
+	u32_t len;
+	u32_t word;
 
-	asize = size;
-	
-	// Align address to 4 byte
-	aaddr = (addr + (4 - 1)) & (u32_t)-4;
-	if (aaddr != addr) {
-		aaddr -= 4;
-		asize += (addr - aaddr);
+	if (FLASH_IS_ALIGNED(addr | size | (ptrdiff_t)dst)) {
+		if (spi_flash_read(addr, (void *)dst, size) != 0) {
+			return SPIFFS_ERR_INTERNAL;
+		}
+		return SPIFFS_OK;
 	}
 
-	// Align size to 4 byte
-	asize = (asize + (4 - 1)) & (u32_t)-4;
-
-	if ((aaddr != addr) || (asize != size)) {
-		// Align buffer
-		buff = malloc(asize + 4);
-		if (!buff) {
+	aaddr = FLASH_ALIGN(addr);
+	asize = FLASH_ALIGN(addr + size + 3) - aaddr;
+	if (asize <= sizeof(flash_scratch)) {
+		if (spi_flash_read(aaddr, (void *)flash_scratch, asize) != 0) {
 			return SPIFFS_ERR_INTERNAL;
 		}
+		memcpy(dst, (u8_t *)flash_scratch + (addr - aaddr), size);
+		return SPIFFS_OK;
+	}
 
-		abuff = (u8_t *)(((ptrdiff_t)buff + (4 - 1)) & (u32_t)-4);
-
-		if (spi_flash_read(aaddr, (void *)abuff, asize) != 0) {
-			free(buff);
+	// Head
+	if (!FLASH_IS_ALIGNED(addr)) {
+		len = 4 - (addr & 3);
+		if (spi_flash_read(aaddr, (void *)&word, 4) != 0) {
 			return SPIFFS_ERR_INTERNAL;
 		}
+		memcpy(dst, (u8_t *)&word + (addr & 3), len);
+		addr += len;
+		dst += len;
+		size -= len;
+	}
 
-		memcpy(dst, abuff + (addr - aaddr), size);
-
-		free(buff);
+	// Body
+	if (FLASH_IS_ALIGNED((ptrdiff_t)dst)) {
+		len = FLASH_ALIGN(size);
+		if (spi_flash_read(addr, (void *)dst, len) != 0) {
+			return SPIFFS_ERR_INTERNAL;
+		}
+		addr += len;
+		dst += len;
+		size -= len;
 	} else {
-		if (spi_flash_read(addr, (void *)dst, size) != 0) {
+		while (size >= 4) {
+			len = FLASH_ALIGN(size);
+			if (len > sizeof(flash_scratch)) {
+				len = sizeof(flash_scratch);
+			}
+			if (spi_flash_read(addr, (void *)flash_scratch, len) != 0) {
+				return SPIFFS_ERR_INTERNAL;
+			}
+			memcpy(dst, flash_scratch, len);
+			addr += len;
+			dst += len;
+			size -= len;
+		}
+	}
+
+	// Tail
+	if (size > 0) {
+		if (spi_flash_read(addr, (void *)&word, 4) != 0) {
 			return SPIFFS_ERR_INTERNAL;
 		}
+		memcpy(dst, &word, size);
 	}
-	
+
     return SPIFFS_OK;
 }
 
 s32_t IRAM_ATTR esp32_spi_flash_write(u32_t addr, u32_t size, const u8_t *src) {
 	u32_t aaddr;
-	u8_t *buff = NULL;
-	u8_t *abuff = NULL;
 	u32_t asize;
+	u32_t len;
+	u32_t word;
 
-	asize = size;
-	
-	// Align address to 4 byte
-	aaddr = (addr + (4 - 1)) & -4;
-	if (aaddr != addr) {
-		aaddr -= 4;
-		asize += (addr - aaddr);
+	if (FLASH_IS_ALIGNED(addr | size | (ptrdiff_t)src)) {
+		if (spi_flash_write(addr, (const void *)src, size) != 0) {
+			return SPIFFS_ERR_INTERNAL;
+		}
+		return SPIFFS_OK;
 	}
 
-	// Align size to 4 byte
-	asize = (asize + (4 - 1)) & -4; 
-
-	if ((aaddr != addr) || (asize != size)) {
-		// Align buffer
-		buff = malloc(asize + 4);
-		if (!buff) {
+	aaddr = FLASH_ALIGN(addr);
+	asize = FLASH_ALIGN(addr + size + 3) - aaddr;
+	if (asize <= sizeof(flash_scratch)) {
+		memset(flash_scratch, 0xff, asize);
+		memcpy((u8_t *)flash_scratch + (addr - aaddr), src, size);
+		if (spi_flash_write(aaddr, (const void *)flash_scratch, asize) != 0) {
 			return SPIFFS_ERR_INTERNAL;
 		}
+		return SPIFFS_OK;
+	}
 
-		abuff = (u8_t *)(((ptrdiff_t)buff + (4 - 1)) & -4);
-
-		if (spi_flash_read(aaddr, (void *)abuff, asize) != 0) {
-			free(buff);
+	// Head
+	if (!FLASH_IS_ALIGNED(addr)) {
+		len = 4 - (addr & 3);
+		word = 0xffffffff;
+		memcpy((u8_t *)&word + (addr & 3), src, len);
+		if (spi_flash_write(aaddr, (const void *)&word, 4) != 0) {
 			return SPIFFS_ERR_INTERNAL;
 		}
+		addr += len;
+		src += len;
+		size -= len;
+	}
 
-		memcpy(abuff + (addr - aaddr), src, size);
-
-		if (spi_flash_write(aaddr, (uint32_t *)abuff, asize) != 0) {
-			free(buff);
+	// Body
+	if (FLASH_IS_ALIGNED((ptrdiff_t)src)) {
+		len = FLASH_ALIGN(size);
+		if (spi_flash_write(addr, (const void *)src, len) != 0) {
 			return SPIFFS_ERR_INTERNAL;
 		}
-
-		free(buff);
+		addr += len;
+		src += len;
+		size -= len;
 	} else {
-		if (spi_flash_write(addr, (uint32_t *)src, size) != 0) {
+		while (size >= 4) {
+			len = FLASH_ALIGN(size);
+			if (len > sizeof(flash_scratch)) {
+				len = sizeof(flash_scratch);
+			}
+			memcpy(flash_scratch, src, len);
+			if (spi_flash_write(addr, (const void *)flash_scratch, len) != 0) {
+				return SPIFFS_ERR_INTERNAL;
+			}
+			addr += len;
+			src += len;
+			size -= len;
+		}
+	}
+
+	// Tail
+	if (size > 0) {
+		word = 0xffffffff;
+		memcpy(&word, src, size);
+		if (spi_flash_write(addr, (const void *)&word, 4) != 0) {
 			return SPIFFS_ERR_INTERNAL;
 		}
 	}
-	
+
     return SPIFFS_OK;
 }
 
 s32_t IRAM_ATTR esp32_spi_flash_erase(u32_t addr, u32_t size) {
-	if (spi_flash_erase_sector(addr >> 12) != 0) {
+	// Erase all sectors in the range, addr and size must be sector aligned
+	if ((addr % FLASH_SECTOR_SIZE) || (size % FLASH_SECTOR_SIZE) || (size == 0)) {
+		return SPIFFS_ERR_INTERNAL;
+	}
+	if (spi_flash_erase_range(addr, size) != 0) {
 		return SPIFFS_ERR_INTERNAL;
 	}
-	
+
     return SPIFFS_OK;
 }
@@ -32,6 +32,11 @@
 
 #include "spiffs.h"
 
+// Size of the aligned scratch buffer for accesses to unaligned RAM buffers
+#ifndef ESP_SPIFFS_SCRATCH_SIZE
+#define ESP_SPIFFS_SCRATCH_SIZE 256
+#endif
+
 s32_t esp32_spi_flash_read(u32_t addr, u32_t size, u8_t *dst);
 s32_t esp32_spi_flash_write(u32_t addr, u32_t size, const u8_t *src);
 s32_t esp32_spi_flash_erase(u32_t addr, u32_t size);
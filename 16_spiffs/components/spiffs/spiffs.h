@@ -60,6 +60,8 @@ extern "C" {
 #define SPIFFS_ERR_IX_MAP_MAPPED        -10038
 #define SPIFFS_ERR_IX_MAP_BAD_RANGE     -10039
 
+#define SPIFFS_ERR_OBJ_INDEX_MEM        -10040
+
 #define SPIFFS_ERR_INTERNAL             -10050
 
 #define SPIFFS_ERR_TEST                 -10100
@@ -275,7 +277,13 @@ typedef struct spiffs_t {
 #if SPIFFS_CACHE_STATS
   u32_t cache_hits;
   u32_t cache_misses;
+  u32_t cache_evictions;
+#endif
 #endif
+
+#if SPIFFS_OBJ_INDEX
+  // object index memory, null if not used
+  void *obj_index;
 #endif
 
   // check callback function
@@ -671,6 +679,23 @@ s32_t SPIFFS_gc_quick(spiffs *fs, u16_t max_free_pages);
  */
 s32_t SPIFFS_gc(spiffs *fs, u32_t size);
 
+/**
+ * Runs one step of incremental garbage collection if less than given number
+ * of blocks are free. A step either erases one block containing only deleted
+ * pages, or moves the used pages out of the block with most deleted pages so
+ * that the next step can erase it.
+ * Call this repeatedly from a low priority task to keep free blocks available,
+ * so that writes do not have to run the garbage collector themselves. The
+ * file system is only locked during one step.
+ *
+ * Will set err_no to SPIFFS_OK if a step was done,
+ * SPIFFS_ERR_NO_DELETED_BLOCKS if there is nothing to do, or other error.
+ *
+ * @param fs              the file system struct
+ * @param min_free_blocks number of free blocks to keep
+ */
+s32_t SPIFFS_gc_step(spiffs *fs, u32_t min_free_blocks);
+
 /**
  * Check if EOF reached.
  * @param fs            the file system struct
@@ -779,6 +804,27 @@ s32_t SPIFFS_ix_map_entries_to_bytes(spiffs *fs, u32_t map_page_ix_entries);
 
 #endif // SPIFFS_IX_MAP
 
+#if SPIFFS_OBJ_INDEX
+
+/**
+ * Attaches an object index to a mounted file system. The index keeps the
+ * object index header page of every file in RAM, so files are opened, stated
+ * and found by name without scanning the object lookup pages. It also keeps
+ * the number of free pages per block to speed up page allocation.
+ * The index is built by scanning the file system once and is kept up to date
+ * by spiffs. It is dropped when the file system is unmounted.
+ * If there are more files than the buffer can hold, the files that do not fit
+ * are found by scanning as without index.
+ * @param fs          the file system struct
+ * @param buf         memory for the index, must be valid until unmount. Use
+ *                    SPIFFS_OBJ_INDEX_MEM_SIZE to get the size needed for a
+ *                    given number of files.
+ * @param buf_size    size of buf
+ */
+s32_t SPIFFS_obj_index(spiffs *fs, void *buf, u32_t buf_size);
+
+#endif // SPIFFS_OBJ_INDEX
+
 
 #if SPIFFS_TEST_VISUALISATION
 /**
@@ -10,20 +10,72 @@
 
 #if SPIFFS_CACHE
 
+// Cache pages are kept in a lru list, most recently used first. Read cache
+// pages are also in a hash bucket list (pix & hash_mask), write cache pages
+// are in the write page list. Free pages are in the free list.
+
+static void spiffs_cache_lru_unlink(spiffs *fs, spiffs_cache *cache, spiffs_cache_page *cp) {
+  if (cp->lru_prev != SPIFFS_CACHE_NONE) {
+    spiffs_get_cache_page_hdr(fs, cache, cp->lru_prev)->lru_next = cp->lru_next;
+  } else {
+    cache->lru_head = cp->lru_next;
+  }
+  if (cp->lru_next != SPIFFS_CACHE_NONE) {
+    spiffs_get_cache_page_hdr(fs, cache, cp->lru_next)->lru_prev = cp->lru_prev;
+  } else {
+    cache->lru_tail = cp->lru_prev;
+  }
+}
+
+static void spiffs_cache_lru_push_front(spiffs *fs, spiffs_cache *cache, spiffs_cache_page *cp) {
+  cp->lru_prev = SPIFFS_CACHE_NONE;
+  cp->lru_next = cache->lru_head;
+  if (cache->lru_head != SPIFFS_CACHE_NONE) {
+    spiffs_get_cache_page_hdr(fs, cache, cache->lru_head)->lru_prev = cp->ix;
+  } else {
+    cache->lru_tail = cp->ix;
+  }
+  cache->lru_head = cp->ix;
+}
+
+// marks cache page as most recently used
+static void spiffs_cache_page_touch(spiffs *fs, spiffs_cache *cache, spiffs_cache_page *cp) {
+  if (cache->lru_head != cp->ix) {
+    spiffs_cache_lru_unlink(fs, cache, cp);
+    spiffs_cache_lru_push_front(fs, cache, cp);
+  }
+}
+
+// removes cache page from a singly linked list (hash bucket or write pages)
+static void spiffs_cache_list_remove(spiffs *fs, spiffs_cache *cache, u16_t *head, spiffs_cache_page *cp) {
+  while (*head != SPIFFS_CACHE_NONE) {
+    if (*head == cp->ix) {
+      *head = cp->hash_next;
+      return;
+    }
+    head = &spiffs_get_cache_page_hdr(fs, cache, *head)->hash_next;
+  }
+}
+
+// adds read cache page with valid pix to its hash bucket
+static void spiffs_cache_page_hash_insert(spiffs_cache *cache, spiffs_cache_page *cp) {
+  u16_t *head = &cache->hash[cp->pix & cache->hash_mask];
+  cp->hash_next = *head;
+  *head = cp->ix;
+}
+
 // returns cached page for give page index, or null if no such cached page
 static spiffs_cache_page *spiffs_cache_page_get(spiffs *fs, spiffs_page_ix pix) {
   spiffs_cache *cache = spiffs_get_cache(fs);
-  if ((cache->cpage_use_map & cache->cpage_use_mask) == 0) return 0;
-  int i;
-  for (i = 0; i < cache->cpage_count; i++) {
-    spiffs_cache_page *cp = spiffs_get_cache_page_hdr(fs, cache, i);
-    if ((cache->cpage_use_map & (1<<i)) &&
-        (cp->flags & SPIFFS_CACHE_FLAG_TYPE_WR) == 0 &&
-        cp->pix == pix ) {
-      SPIFFS_CACHE_DBG("CACHE_GET: have cache page "_SPIPRIi" for "_SPIPRIpg"\n", i, pix);
-      cp->last_access = cache->last_access;
+  u16_t ix = cache->hash[pix & cache->hash_mask];
+  while (ix != SPIFFS_CACHE_NONE) {
+    spiffs_cache_page *cp = spiffs_get_cache_page_hdr(fs, cache, ix);
+    if (cp->pix == pix) {
+      SPIFFS_CACHE_DBG("CACHE_GET: have cache page "_SPIPRIi" for "_SPIPRIpg"\n", ix, pix);
+      spiffs_cache_page_touch(fs, cache, cp);
       return cp;
     }
+    ix = cp->hash_next;
   }
   //SPIFFS_CACHE_DBG("CACHE_GET: no cache for "_SPIPRIpg"\n", pix);
   return 0;
@@ -34,7 +86,7 @@ static s32_t spiffs_cache_page_free(spiffs *fs, int ix, u8_t write_back) {
   s32_t res = SPIFFS_OK;
   spiffs_cache *cache = spiffs_get_cache(fs);
   spiffs_cache_page *cp = spiffs_get_cache_page_hdr(fs, cache, ix);
-  if (cache->cpage_use_map & (1<<ix)) {
+  if (cp->used) {
     if (write_back &&
         (cp->flags & SPIFFS_CACHE_FLAG_TYPE_WR) == 0 &&
         (cp->flags & SPIFFS_CACHE_FLAG_DIRTY)) {
@@ -42,14 +94,19 @@ static s32_t spiffs_cache_page_free(spiffs *fs, int ix, u8_t write_back) {
       res = SPIFFS_HAL_WRITE(fs, SPIFFS_PAGE_TO_PADDR(fs, cp->pix), SPIFFS_CFG_LOG_PAGE_SZ(fs), mem);
     }
 
-    cp->flags = 0;
-    cache->cpage_use_map &= ~(1 << ix);
-
     if (cp->flags & SPIFFS_CACHE_FLAG_TYPE_WR) {
+      spiffs_cache_list_remove(fs, cache, &cache->wr_head, cp);
       SPIFFS_CACHE_DBG("CACHE_FREE: free cache page "_SPIPRIi" objid "_SPIPRIid"\n", ix, cp->obj_id);
     } else {
+      spiffs_cache_list_remove(fs, cache, &cache->hash[cp->pix & cache->hash_mask], cp);
       SPIFFS_CACHE_DBG("CACHE_FREE: free cache page "_SPIPRIi" pix "_SPIPRIpg"\n", ix, cp->pix);
     }
+
+    spiffs_cache_lru_unlink(fs, cache, cp);
+    cp->flags = 0;
+    cp->used = 0;
+    cp->lru_next = cache->free_head;
+    cache->free_head = cp->ix;
   }
 
   return res;
@@ -60,50 +117,43 @@ static s32_t spiffs_cache_page_remove_oldest(spiffs *fs, u8_t flag_mask, u8_t fl
   s32_t res = SPIFFS_OK;
   spiffs_cache *cache = spiffs_get_cache(fs);
 
-  if ((cache->cpage_use_map & cache->cpage_use_mask) != cache->cpage_use_mask) {
+  if (cache->free_head != SPIFFS_CACHE_NONE) {
     // at least one free cpage
     return SPIFFS_OK;
   }
 
-  // all busy, scan thru all to find the cpage which has oldest access
-  int i;
-  int cand_ix = -1;
-  u32_t oldest_val = 0;
-  for (i = 0; i < cache->cpage_count; i++) {
-    spiffs_cache_page *cp = spiffs_get_cache_page_hdr(fs, cache, i);
-    if ((cache->last_access - cp->last_access) > oldest_val &&
-        (cp->flags & flag_mask) == flags) {
-      oldest_val = cache->last_access - cp->last_access;
-      cand_ix = i;
+  // all busy, walk from the least recently used page to find a matching cpage
+  u16_t ix = cache->lru_tail;
+  while (ix != SPIFFS_CACHE_NONE) {
+    spiffs_cache_page *cp = spiffs_get_cache_page_hdr(fs, cache, ix);
+    if ((cp->flags & flag_mask) == flags) {
+#if SPIFFS_CACHE_STATS
+      fs->cache_evictions++;
+#endif
+      res = spiffs_cache_page_free(fs, ix, 1);
+      break;
     }
-  }
-
-  if (cand_ix >= 0) {
-    res = spiffs_cache_page_free(fs, cand_ix, 1);
+    ix = cp->lru_prev;
   }
 
   return res;
 }
 
 // allocates a new cached page and returns it, or null if all cache pages are busy
+// the caller must set flags and add read pages with spiffs_cache_page_hash_insert
 static spiffs_cache_page *spiffs_cache_page_allocate(spiffs *fs) {
   spiffs_cache *cache = spiffs_get_cache(fs);
-  if (cache->cpage_use_map == 0xffffffff) {
+  if (cache->free_head == SPIFFS_CACHE_NONE) {
     // out of cache memory
     return 0;
   }
-  int i;
-  for (i = 0; i < cache->cpage_count; i++) {
-    if ((cache->cpage_use_map & (1<<i)) == 0) {
-      spiffs_cache_page *cp = spiffs_get_cache_page_hdr(fs, cache, i);
-      cache->cpage_use_map |= (1<<i);
-      cp->last_access = cache->last_access;
-      SPIFFS_CACHE_DBG("CACHE_ALLO: allocated cache page "_SPIPRIi"\n", i);
-      return cp;
-    }
-  }
-  // out of cache entries
-  return 0;
+  spiffs_cache_page *cp = spiffs_get_cache_page_hdr(fs, cache, cache->free_head);
+  cache->free_head = cp->lru_next;
+  cp->used = 1;
+  cp->hash_next = SPIFFS_CACHE_NONE;
+  spiffs_cache_lru_push_front(fs, cache, cp);
+  SPIFFS_CACHE_DBG("CACHE_ALLO: allocated cache page "_SPIPRIi"\n", cp->ix);
+  return cp;
 }
 
 // drops the cache page for give page index
@@ -128,13 +178,11 @@ s32_t spiffs_phys_rd(
   s32_t res = SPIFFS_OK;
   spiffs_cache *cache = spiffs_get_cache(fs);
   spiffs_cache_page *cp =  spiffs_cache_page_get(fs, SPIFFS_PADDR_TO_PAGE(fs, addr));
-  cache->last_access++;
   if (cp) {
     // we've already got one, you see
 #if SPIFFS_CACHE_STATS
     fs->cache_hits++;
 #endif
-    cp->last_access = cache->last_access;
     u8_t *mem =  spiffs_get_cache_page(fs, cache, cp->ix);
     memcpy(dst, &mem[SPIFFS_PADDR_TO_PAGE_OFFSET(fs, addr)], len);
   } else {
@@ -153,6 +201,7 @@ s32_t spiffs_phys_rd(
     if (cp) {
       cp->flags = SPIFFS_CACHE_FLAG_WRTHRU;
       cp->pix = SPIFFS_PADDR_TO_PAGE(fs, addr);
+      spiffs_cache_page_hash_insert(cache, cp);
 
       s32_t res2 = SPIFFS_HAL_READ(fs,
           addr - SPIFFS_PADDR_TO_PAGE_OFFSET(fs, addr),
@@ -203,9 +252,6 @@ s32_t spiffs_phys_wr(
     u8_t *mem =  spiffs_get_cache_page(fs, cache, cp->ix);
     memcpy(&mem[SPIFFS_PADDR_TO_PAGE_OFFSET(fs, addr)], src, len);
 
-    cache->last_access++;
-    cp->last_access = cache->last_access;
-
     if (cp->flags & SPIFFS_CACHE_FLAG_WRTHRU) {
       // page is being updated, no write-cache, just pass thru
       return SPIFFS_HAL_WRITE(fs, addr, len, src);
@@ -222,20 +268,14 @@ s32_t spiffs_phys_wr(
 // returns the cache page that this fd refers, or null if no cache page
 spiffs_cache_page *spiffs_cache_page_get_by_fd(spiffs *fs, spiffs_fd *fd) {
   spiffs_cache *cache = spiffs_get_cache(fs);
+  u16_t ix = cache->wr_head;
 
-  if ((cache->cpage_use_map & cache->cpage_use_mask) == 0) {
-    // all cpages free, no cpage cannot be assigned to obj_id
-    return 0;
-  }
-
-  int i;
-  for (i = 0; i < cache->cpage_count; i++) {
-    spiffs_cache_page *cp = spiffs_get_cache_page_hdr(fs, cache, i);
-    if ((cache->cpage_use_map & (1<<i)) &&
-        (cp->flags & SPIFFS_CACHE_FLAG_TYPE_WR) &&
-        cp->obj_id == fd->obj_id) {
+  while (ix != SPIFFS_CACHE_NONE) {
+    spiffs_cache_page *cp = spiffs_get_cache_page_hdr(fs, cache, ix);
+    if (cp->obj_id == fd->obj_id) {
       return cp;
     }
+    ix = cp->hash_next;
   }
 
   return 0;
@@ -255,6 +295,8 @@ spiffs_cache_page *spiffs_cache_page_allocate_by_fd(spiffs *fs, spiffs_fd *fd) {
 
   cp->flags = SPIFFS_CACHE_FLAG_TYPE_WR;
   cp->obj_id = fd->obj_id;
+  cp->hash_next = spiffs_get_cache(fs)->wr_head;
+  spiffs_get_cache(fs)->wr_head = cp->ix;
   fd->cache_page = cp;
   return cp;
 }
@@ -281,34 +323,40 @@ void spiffs_cache_fd_release(spiffs *fs, spiffs_cache_page *cp) {
 void spiffs_cache_init(spiffs *fs) {
   if (fs->cache == 0) return;
   u32_t sz = fs->cache_size;
-  u32_t cache_mask = 0;
   int i;
-  int cache_entries =
-      (sz - sizeof(spiffs_cache)) / (SPIFFS_CACHE_PAGE_SIZE(fs));
-  if (cache_entries <= 0) return;
-
-  for (i = 0; i < cache_entries; i++) {
-    cache_mask <<= 1;
-    cache_mask |= 1;
+  if (sz <= sizeof(spiffs_cache)) return;
+  // each cache page needs one u16_t for the page and max. one u16_t for the hash buckets
+  u32_t cache_entries =
+      (sz - sizeof(spiffs_cache)) / (SPIFFS_CACHE_PAGE_SIZE(fs) + 2*sizeof(u16_t));
+  if (cache_entries == 0) return;
+  if (cache_entries >= SPIFFS_CACHE_NONE) cache_entries = SPIFFS_CACHE_NONE-1;
+  u32_t hash_size = 1;
+  while (hash_size < cache_entries) {
+    hash_size <<= 1;
   }
 
-  spiffs_cache cache;
-  memset(&cache, 0, sizeof(spiffs_cache));
-  cache.cpage_count = cache_entries;
-  cache.cpages = (u8_t *)((u8_t *)fs->cache + sizeof(spiffs_cache));
-
-  cache.cpage_use_map = 0xffffffff;
-  cache.cpage_use_mask = cache_mask;
-  memcpy(fs->cache, &cache, sizeof(spiffs_cache));
-
   spiffs_cache *c = spiffs_get_cache(fs);
+  memset(c, 0, sizeof(spiffs_cache));
+  c->cpage_count = cache_entries;
+  c->cpages = (u8_t *)((u8_t *)fs->cache + sizeof(spiffs_cache));
+  c->hash = (u16_t *)(c->cpages + cache_entries * SPIFFS_CACHE_PAGE_SIZE(fs));
+  c->hash_mask = hash_size - 1;
+  c->lru_head = SPIFFS_CACHE_NONE;
+  c->lru_tail = SPIFFS_CACHE_NONE;
+  c->wr_head = SPIFFS_CACHE_NONE;
 
   memset(c->cpages, 0, c->cpage_count * SPIFFS_CACHE_PAGE_SIZE(fs));
+  for (i = 0; i < (int)hash_size; i++) {
+    c->hash[i] = SPIFFS_CACHE_NONE;
+  }
 
-  c->cpage_use_map &= ~(c->cpage_use_mask);
-  for (i = 0; i < cache.cpage_count; i++) {
-    spiffs_get_cache_page_hdr(fs, c, i)->ix = i;
+  // all pages are free
+  for (i = 0; i < c->cpage_count; i++) {
+    spiffs_cache_page *cp = spiffs_get_cache_page_hdr(fs, c, i);
+    cp->ix = i;
+    cp->lru_next = (i + 1 < c->cpage_count) ? i + 1 : SPIFFS_CACHE_NONE;
   }
+  c->free_head = 0;
 }
 
 #endif // SPIFFS_CACHE
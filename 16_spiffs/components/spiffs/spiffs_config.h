@@ -105,9 +105,10 @@ QueueHandle_t spiffs_mutex;
 #define SPIFFS_CACHE_WR                 1
 #endif
 
-// Enable/disable statistics on caching. Debug/test purpose only.
+// Enable/disable statistics on caching (hits, misses, evictions).
+// See spiffs_cache_stat() in spiffs_vfs.c.
 #ifndef  SPIFFS_CACHE_STATS
-#define SPIFFS_CACHE_STATS              0
+#define SPIFFS_CACHE_STATS              1
 #endif
 #endif
 
@@ -316,6 +317,20 @@ QueueHandle_t spiffs_mutex;
 #define SPIFFS_IX_MAP                         1
 #endif
 
+// Enable to be able to keep an object index in RAM.
+// Opening, stating or searching a file by name or object id normally scans all
+// object lookup pages of the file system, so the time grows with the partition
+// size. With an object index, given by SPIFFS_obj_index after mounting, spiffs
+// keeps the object id, a name hash and the page of every object index header,
+// plus the number of free pages per block. Lookups read only the found header
+// page. The index is built with one scan and is updated on every write,
+// rename, delete and garbage collection. Memory is bounded by the user; if
+// there are more objects than index entries, lookups of unindexed objects fall
+// back to scanning.
+#ifndef SPIFFS_OBJ_INDEX
+#define SPIFFS_OBJ_INDEX                      1
+#endif
+
 // Set SPIFFS_TEST_VISUALISATION to non-zero to enable SPIFFS_vis function
 // in the api. This function will visualize all filesystem using given printf
 // function.
@@ -195,6 +195,109 @@ s32_t spiffs_gc_check(
   return res;
 }
 
+// Counts free, deleted and used pages of a block
+static s32_t spiffs_gc_block_stats(
+    spiffs *fs,
+    spiffs_block_ix bix,
+    u32_t *free,
+    u32_t *dele,
+    u32_t *allo) {
+  s32_t res = SPIFFS_OK;
+  int obj_lookup_page = 0;
+  int entries_per_page = (SPIFFS_CFG_LOG_PAGE_SZ(fs) / sizeof(spiffs_obj_id));
+  spiffs_obj_id *obj_lu_buf = (spiffs_obj_id *)fs->lu_work;
+  int cur_entry = 0;
+
+  *free = 0;
+  *dele = 0;
+  *allo = 0;
+  // check each object lookup page
+  while (res == SPIFFS_OK && obj_lookup_page < (int)SPIFFS_OBJ_LOOKUP_PAGES(fs)) {
+    int entry_offset = obj_lookup_page * entries_per_page;
+    res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_LU | SPIFFS_OP_C_READ,
+        0, bix * SPIFFS_CFG_LOG_BLOCK_SZ(fs) + SPIFFS_PAGE_TO_PADDR(fs, obj_lookup_page), SPIFFS_CFG_LOG_PAGE_SZ(fs), fs->lu_work);
+    // check each entry
+    while (res == SPIFFS_OK &&
+        cur_entry - entry_offset < entries_per_page && cur_entry < (int)(SPIFFS_PAGES_PER_BLOCK(fs)-SPIFFS_OBJ_LOOKUP_PAGES(fs))) {
+      spiffs_obj_id obj_id = obj_lu_buf[cur_entry-entry_offset];
+      if (obj_id == SPIFFS_OBJ_ID_FREE) {
+        (*free)++;
+      } else if (obj_id == SPIFFS_OBJ_ID_DELETED) {
+        (*dele)++;
+      } else {
+        (*allo)++;
+      }
+      cur_entry++;
+    } // per entry
+    obj_lookup_page++;
+  } // per object lookup page
+  return res;
+}
+
+// Runs one incremental garbage collection step if less than min_free_blocks
+// blocks are free. A step either erases one block with only deleted pages, or
+// moves the used pages out of the best candidate block without free pages.
+// The cleaned block then has only deleted pages and is erased by the next
+// step. Meant to be called repeatedly from a background task, one step per
+// SPIFFS_LOCK, so that writers are only stalled for one step.
+// Returns SPIFFS_OK if a step was done and SPIFFS_ERR_NO_DELETED_BLOCKS if
+// there is nothing to do.
+s32_t spiffs_gc_step(
+    spiffs *fs,
+    u32_t min_free_blocks) {
+  s32_t res;
+  spiffs_block_ix *cands;
+  int count;
+  int i;
+  s32_t free_pages =
+      (SPIFFS_PAGES_PER_BLOCK(fs) - SPIFFS_OBJ_LOOKUP_PAGES(fs)) * (fs->block_count - 2)
+      - fs->stats_p_allocated - fs->stats_p_deleted;
+
+  if (fs->free_blocks >= min_free_blocks || fs->stats_p_deleted == 0) {
+    return SPIFFS_ERR_NO_DELETED_BLOCKS;
+  }
+
+  // erase a block with only deleted pages, e.g. cleaned by the previous step
+  res = spiffs_gc_quick(fs, 0);
+  if (res != SPIFFS_ERR_NO_DELETED_BLOCKS) {
+    return res;
+  }
+
+  res = spiffs_gc_find_candidate(fs, &cands, &count, 0);
+  SPIFFS_CHECK_RES(res);
+  for (i = 0; i < count; i++) {
+    // candidates are in fs->work, which is used by cleaning
+    spiffs_block_ix cand = cands[i];
+    u32_t free, dele, allo;
+    res = spiffs_gc_block_stats(fs, cand, &free, &dele, &allo);
+    SPIFFS_CHECK_RES(res);
+    // writers may still use free pages in the block, and the used pages
+    // must fit into free pages elsewhere
+    if (free == 0 && dele > 0 && (s32_t)allo < free_pages) {
+      SPIFFS_GC_DBG("gc_step: cleaning block "_SPIPRIbl" del:"_SPIPRIi" use:"_SPIPRIi"\n", cand, dele, allo);
+#if SPIFFS_GC_STATS
+      fs->stats_gc_runs++;
+#endif
+      fs->cleaning = 1;
+      res = spiffs_gc_clean(fs, cand);
+      fs->cleaning = 0;
+      SPIFFS_CHECK_RES(res);
+      res = spiffs_gc_block_stats(fs, cand, &free, &dele, &allo);
+      SPIFFS_CHECK_RES(res);
+      if (allo > 0) {
+        // pages not referenced by any index are left, erase now as
+        // spiffs_gc_check does, it would not qualify for spiffs_gc_quick
+        res = spiffs_gc_erase_page_stats(fs, cand);
+        SPIFFS_CHECK_RES(res);
+        res = spiffs_gc_erase_block(fs, cand);
+      }
+      return res;
+    }
+  }
+
+  return SPIFFS_ERR_NO_DELETED_BLOCKS;
+}
+
 // Updates page statistics for a block that is about to be erased
 s32_t spiffs_gc_erase_page_stats(
     spiffs *fs,
@@ -333,7 +436,8 @@ s32_t spiffs_gc_find_candidate(
         }
         cand_ix++;
       }
-      (*candidate_count)++;
+      // the table keeps the best max_candidates blocks
+      if (*candidate_count < max_candidates) (*candidate_count)++;
     }
 
     cur_entry = 0;
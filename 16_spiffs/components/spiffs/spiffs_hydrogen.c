@@ -26,7 +26,7 @@ u32_t SPIFFS_buffer_bytes_for_filedescs(spiffs *fs, u32_t num_descs) {
 }
 #if SPIFFS_CACHE
 u32_t SPIFFS_buffer_bytes_for_cache(spiffs *fs, u32_t num_pages) {
-  return sizeof(spiffs_cache) + num_pages * (sizeof(spiffs_cache_page) + SPIFFS_CFG_LOG_PAGE_SZ(fs));
+  return SPIFFS_CACHE_MEM_SIZE(SPIFFS_CFG_LOG_PAGE_SZ(fs), num_pages);
 }
 #endif
 #endif
@@ -113,7 +113,7 @@ s32_t SPIFFS_mount(spiffs *fs, spiffs_config *config, u8_t *work,
 
 #if SPIFFS_CACHE
   fs->cache = cache;
-  fs->cache_size = (cache_size > (SPIFFS_CFG_LOG_PAGE_SZ(fs)*32)) ? SPIFFS_CFG_LOG_PAGE_SZ(fs)*32 : cache_size;
+  fs->cache_size = cache_size;
   spiffs_cache_init(fs);
 #endif
 
@@ -161,6 +161,9 @@ void SPIFFS_unmount(spiffs *fs) {
       spiffs_fd_return(fs, cur_fd->file_nbr);
     }
   }
+#if SPIFFS_OBJ_INDEX
+  fs->obj_index = 0;
+#endif
   fs->mounted = 0;
 
   SPIFFS_UNLOCK(fs);
@@ -1070,6 +1073,11 @@ s32_t SPIFFS_check(spiffs *fs) {
   SPIFFS_API_CHECK_MOUNT(fs);
   SPIFFS_LOCK(fs);
 
+#if SPIFFS_OBJ_INDEX
+  void *obj_index = fs->obj_index;
+  fs->obj_index = 0;
+#endif
+
   res = spiffs_lookup_consistency_check(fs, 0);
 
   res = spiffs_object_index_consistency_check(fs);
@@ -1078,6 +1086,14 @@ s32_t SPIFFS_check(spiffs *fs) {
 
   res = spiffs_obj_lu_scan(fs);
 
+#if SPIFFS_OBJ_INDEX
+  // the checks may have moved or deleted pages without updating the index
+  if (obj_index) {
+    fs->obj_index = obj_index;
+    res = spiffs_obj_index_build(fs);
+  }
+#endif
+
   SPIFFS_UNLOCK(fs);
   return res;
 #endif // SPIFFS_READ_ONLY
@@ -1144,6 +1160,24 @@ s32_t SPIFFS_gc(spiffs *fs, u32_t size) {
 #endif // SPIFFS_READ_ONLY
 }
 
+s32_t SPIFFS_gc_step(spiffs *fs, u32_t min_free_blocks) {
+#if SPIFFS_READ_ONLY
+  (void)fs; (void)min_free_blocks;
+  return SPIFFS_ERR_RO_NOT_IMPL;
+#else
+  s32_t res;
+  SPIFFS_API_CHECK_CFG(fs);
+  SPIFFS_API_CHECK_MOUNT(fs);
+  SPIFFS_LOCK(fs);
+
+  res = spiffs_gc_step(fs, min_free_blocks);
+
+  SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+  SPIFFS_UNLOCK(fs);
+  return 0;
+#endif // SPIFFS_READ_ONLY
+}
+
 s32_t SPIFFS_eof(spiffs *fs, spiffs_file fh) {
   s32_t res;
   SPIFFS_API_CHECK_CFG(fs);
@@ -1197,6 +1231,29 @@ s32_t SPIFFS_set_file_callback_func(spiffs *fs, spiffs_file_callback cb_func) {
   return 0;
 }
 
+#if SPIFFS_OBJ_INDEX
+
+s32_t SPIFFS_obj_index(spiffs *fs, void *buf, u32_t buf_size) {
+  s32_t res;
+  SPIFFS_API_CHECK_CFG(fs);
+  SPIFFS_API_CHECK_MOUNT(fs);
+  SPIFFS_LOCK(fs);
+
+  res = spiffs_obj_index_init(fs, buf, buf_size);
+  SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+
+  res = spiffs_obj_index_build(fs);
+  if (res != SPIFFS_OK) {
+    fs->obj_index = 0;
+  }
+  SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+
+  SPIFFS_UNLOCK(fs);
+  return res;
+}
+
+#endif // SPIFFS_OBJ_INDEX
+
 #if SPIFFS_IX_MAP
 
 s32_t SPIFFS_ix_map(spiffs *fs,  spiffs_file fh, spiffs_ix_map *map,
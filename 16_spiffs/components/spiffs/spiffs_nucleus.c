@@ -239,6 +239,9 @@ s32_t spiffs_erase_block(
     size -= SPIFFS_CFG_PHYS_ERASE_SZ(fs);
   }
   fs->free_blocks++;
+#if SPIFFS_OBJ_INDEX
+  spiffs_obj_index_block_erased(fs, bix);
+#endif
 
   // register erase count for this block
   res = _spiffs_wr(fs, SPIFFS_OP_C_WRTHRU | SPIFFS_OP_T_OBJ_LU2, 0,
@@ -463,6 +466,9 @@ s32_t spiffs_obj_lu_find_free(
       return SPIFFS_ERR_FULL;
     }
   }
+#if SPIFFS_OBJ_INDEX
+  spiffs_obj_index_skip_full_blocks(fs, &starting_block, &starting_lu_entry);
+#endif
   res = spiffs_obj_lu_find_id(fs, starting_block, starting_lu_entry,
       SPIFFS_OBJ_ID_FREE, block_ix, lu_entry);
   if (res == SPIFFS_OK) {
@@ -471,6 +477,9 @@ s32_t spiffs_obj_lu_find_free(
     if (*lu_entry == 0) {
       fs->free_blocks--;
     }
+#if SPIFFS_OBJ_INDEX
+    spiffs_obj_index_page_allocated(fs, *block_ix);
+#endif
   }
   if (res == SPIFFS_ERR_FULL) {
     SPIFFS_DBG("fs full\n");
@@ -534,6 +543,22 @@ s32_t spiffs_obj_lu_find_id_and_span(
   spiffs_block_ix bix;
   int entry;
 
+#if SPIFFS_OBJ_INDEX
+  if (spix == 0 && (obj_id & SPIFFS_OBJ_ID_IX_FLAG) && exclusion_pix == 0) {
+    spiffs_page_ix hdr_pix;
+    res = spiffs_obj_index_find_by_id(fs, obj_id, &hdr_pix);
+    if (res != SPIFFS_VIS_END) {
+      SPIFFS_CHECK_RES(res);
+      if (pix) {
+        *pix = hdr_pix;
+      }
+      fs->cursor_block_ix = SPIFFS_BLOCK_FOR_PAGE(fs, hdr_pix);
+      fs->cursor_obj_lu_entry = SPIFFS_OBJ_LOOKUP_ENTRY_FOR_PAGE(fs, hdr_pix);
+      return res;
+    }
+  }
+#endif
+
   res = spiffs_obj_lu_find_entry_visitor(fs,
       fs->cursor_block_ix,
       fs->cursor_obj_lu_entry,
@@ -1048,6 +1073,18 @@ void spiffs_cb_object_event(
   spiffs_obj_id obj_id = obj_id_raw & ~SPIFFS_OBJ_ID_IX_FLAG;
   u32_t i;
   spiffs_fd *fds = (spiffs_fd *)fs->fd_space;
+
+#if SPIFFS_OBJ_INDEX
+  // update object index, moved headers are given without name
+  if (spix == 0) {
+    if (ev == SPIFFS_EV_IX_DEL) {
+      spiffs_obj_index_remove(fs, obj_id);
+    } else {
+      spiffs_obj_index_update(fs, obj_id, new_pix,
+          (objix && ev != SPIFFS_EV_IX_MOV) ? ((spiffs_page_object_ix_header *)objix)->name : 0);
+    }
+  }
+#endif
   for (i = 0; i < fs->fd_count; i++) {
     spiffs_fd *cur_fd = &fds[i];
 #if SPIFFS_TEMPORAL_FD_CACHE
@@ -1659,6 +1696,20 @@ s32_t spiffs_object_find_object_index_header_by_name(
   spiffs_block_ix bix;
   int entry;
 
+#if SPIFFS_OBJ_INDEX
+  spiffs_page_ix hdr_pix;
+  res = spiffs_obj_index_find_by_name(fs, name, &hdr_pix);
+  if (res != SPIFFS_VIS_END) {
+    SPIFFS_CHECK_RES(res);
+    if (pix) {
+      *pix = hdr_pix;
+    }
+    fs->cursor_block_ix = SPIFFS_BLOCK_FOR_PAGE(fs, hdr_pix);
+    fs->cursor_obj_lu_entry = SPIFFS_OBJ_LOOKUP_ENTRY_FOR_PAGE(fs, hdr_pix);
+    return res;
+  }
+#endif
+
   res = spiffs_obj_lu_find_entry_visitor(fs,
       fs->cursor_block_ix,
       fs->cursor_obj_lu_entry,
@@ -363,6 +363,13 @@
 #define SPIFFS_CACHE_PAGE_SIZE(fs) \
   (sizeof(spiffs_cache_page) + SPIFFS_CFG_LOG_PAGE_SZ(fs))
 
+// no cache page, end of a cache page list
+#define SPIFFS_CACHE_NONE             ((u16_t)0xffff)
+
+// memory needed for given number of cache pages: struct, pages and hash buckets
+#define SPIFFS_CACHE_MEM_SIZE(log_page_sz, pages) \
+  (sizeof(spiffs_cache) + (pages) * (sizeof(spiffs_cache_page) + (log_page_sz) + 2*sizeof(u16_t)))
+
 #define spiffs_get_cache(fs) \
   ((spiffs_cache *)((fs)->cache))
 
@@ -376,10 +383,16 @@
 typedef struct {
   // cache flags
   u8_t flags;
+  // set if the cache page is allocated
+  u8_t used;
   // cache page index
-  u8_t ix;
-  // last access of this cache page
-  u32_t last_access;
+  u16_t ix;
+  // lru list: more recently used page, less recently used page
+  // free pages are linked by lru_next
+  u16_t lru_prev;
+  u16_t lru_next;
+  // next read cache page in the same hash bucket, or next write cache page
+  u16_t hash_next;
   union {
     // type read cache
     struct {
@@ -402,15 +415,71 @@ typedef struct {
 
 // cache struct
 typedef struct {
-  u8_t cpage_count;
-  u32_t last_access;
-  u32_t cpage_use_map;
-  u32_t cpage_use_mask;
+  u16_t cpage_count;
+  // most recently and least recently used cache page
+  u16_t lru_head;
+  u16_t lru_tail;
+  // first free cache page
+  u16_t free_head;
+  // first write cache page
+  u16_t wr_head;
+  // number of hash buckets - 1, number of buckets is a power of 2
+  u16_t hash_mask;
+  // hash buckets, first read cache page for (pix & hash_mask)
+  u16_t *hash;
   u8_t *cpages;
 } spiffs_cache;
 
 #endif
 
+#if SPIFFS_OBJ_INDEX
+
+// no object index entry, end of an entry list
+#define SPIFFS_OBJ_INDEX_NONE         ((u16_t)0xffff)
+
+// memory needed for an object index of given number of blocks and entries:
+// struct, free pages per block, entries and hash buckets
+#define SPIFFS_OBJ_INDEX_MEM_SIZE(blocks, entries) \
+  (sizeof(spiffs_obj_index) + (blocks) * sizeof(u16_t) + \
+      (entries) * (sizeof(spiffs_obj_index_entry) + 2*sizeof(u16_t)))
+
+#define spiffs_get_obj_index(fs) \
+  ((spiffs_obj_index *)((fs)->obj_index))
+
+// object index entry, one per object index header page
+typedef struct {
+  // object id with SPIFFS_OBJ_ID_IX_FLAG
+  spiffs_obj_id obj_id;
+  // object index header page
+  spiffs_page_ix pix;
+  // hash of the object name
+  u16_t name_hash;
+  // next entry in the same object id hash bucket, or next free entry
+  u16_t id_next;
+  // next entry in the same name hash bucket
+  u16_t name_next;
+} spiffs_obj_index_entry;
+
+// object index struct
+typedef struct {
+  u16_t entry_count;
+  // number of hash buckets - 1, number of buckets is a power of 2
+  u16_t hash_mask;
+  // first free entry
+  u16_t free_head;
+  // set if all objects of the file system are in the index
+  u8_t complete;
+  // number of free object lookup entries per block
+  u16_t *block_free;
+  // hash buckets, first entry for (obj_id & hash_mask)
+  u16_t *id_hash;
+  // hash buckets, first entry for (name_hash & hash_mask)
+  u16_t *name_hash;
+  spiffs_obj_index_entry *entries;
+} spiffs_obj_index;
+
+#endif
+
 
 // spiffs nucleus file descriptor
 typedef struct {
@@ -735,6 +804,10 @@ s32_t spiffs_gc_clean(
     spiffs *fs,
     spiffs_block_ix bix);
 
+s32_t spiffs_gc_step(
+    spiffs *fs,
+    u32_t min_free_blocks);
+
 s32_t spiffs_gc_quick(
     spiffs *fs, u16_t max_free_pages);
 
@@ -761,6 +834,49 @@ void spiffs_fd_temporal_cache_rehash(
     const char *new_path);
 #endif
 
+#if SPIFFS_OBJ_INDEX
+s32_t spiffs_obj_index_init(
+    spiffs *fs,
+    void *buf,
+    u32_t buf_size);
+
+s32_t spiffs_obj_index_build(
+    spiffs *fs);
+
+void spiffs_obj_index_update(
+    spiffs *fs,
+    spiffs_obj_id obj_id,
+    spiffs_page_ix pix,
+    const u8_t *name);
+
+void spiffs_obj_index_remove(
+    spiffs *fs,
+    spiffs_obj_id obj_id);
+
+s32_t spiffs_obj_index_find_by_id(
+    spiffs *fs,
+    spiffs_obj_id obj_id,
+    spiffs_page_ix *pix);
+
+s32_t spiffs_obj_index_find_by_name(
+    spiffs *fs,
+    const u8_t name[SPIFFS_OBJ_NAME_LEN],
+    spiffs_page_ix *pix);
+
+void spiffs_obj_index_skip_full_blocks(
+    spiffs *fs,
+    spiffs_block_ix *bix,
+    int *lu_entry);
+
+void spiffs_obj_index_page_allocated(
+    spiffs *fs,
+    spiffs_block_ix bix);
+
+void spiffs_obj_index_block_erased(
+    spiffs *fs,
+    spiffs_block_ix bix);
+#endif
+
 #if SPIFFS_CACHE
 void spiffs_cache_init(
     spiffs *fs);
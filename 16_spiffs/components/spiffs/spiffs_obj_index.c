@@ -0,0 +1,336 @@
+/*
+ * spiffs_obj_index.c
+ *
+ * In-RAM index of object index header pages and free pages per block.
+ */
+
+#include "spiffs.h"
+#include "spiffs_nucleus.h"
+
+#if SPIFFS_OBJ_INDEX
+
+// Entries are in an object id hash bucket list (obj_id & hash_mask) and in a
+// name hash bucket list (name_hash & hash_mask). Unused entries are in the
+// free list, linked by id_next.
+// The index is only a hint where to find an object index header page: every
+// hit is verified by reading the page header. A miss is final only when
+// looking up by name in a complete index, all other misses fall back to
+// scanning the object lookup pages.
+
+// djb2 hash, folded to 16 bits
+static u16_t spiffs_obj_index_hash(const u8_t *name) {
+  u32_t hash = 5381;
+  u8_t c;
+  int i = 0;
+  while (i < SPIFFS_OBJ_NAME_LEN && (c = name[i++])) {
+    hash = (hash * 33) ^ c;
+  }
+  return (u16_t)(hash ^ (hash >> 16));
+}
+
+static spiffs_obj_index_entry *spiffs_obj_index_get(spiffs_obj_index *oix, spiffs_obj_id obj_id) {
+  u16_t ix = oix->id_hash[obj_id & oix->hash_mask];
+  while (ix != SPIFFS_OBJ_INDEX_NONE) {
+    spiffs_obj_index_entry *e = &oix->entries[ix];
+    if (e->obj_id == obj_id) {
+      return e;
+    }
+    ix = e->id_next;
+  }
+  return 0;
+}
+
+static void spiffs_obj_index_name_unlink(spiffs_obj_index *oix, u16_t ix) {
+  u16_t *link = &oix->name_hash[oix->entries[ix].name_hash & oix->hash_mask];
+  while (*link != SPIFFS_OBJ_INDEX_NONE) {
+    if (*link == ix) {
+      *link = oix->entries[ix].name_next;
+      return;
+    }
+    link = &oix->entries[*link].name_next;
+  }
+}
+
+static void spiffs_obj_index_name_link(spiffs_obj_index *oix, u16_t ix, u16_t name_hash) {
+  u16_t *bucket = &oix->name_hash[name_hash & oix->hash_mask];
+  oix->entries[ix].name_hash = name_hash;
+  oix->entries[ix].name_next = *bucket;
+  *bucket = ix;
+}
+
+static void spiffs_obj_index_clear(spiffs_obj_index *oix) {
+  u16_t i;
+  for (i = 0; i <= oix->hash_mask; i++) {
+    oix->id_hash[i] = SPIFFS_OBJ_INDEX_NONE;
+    oix->name_hash[i] = SPIFFS_OBJ_INDEX_NONE;
+  }
+  for (i = 0; i < oix->entry_count; i++) {
+    oix->entries[i].obj_id = SPIFFS_OBJ_ID_FREE;
+    oix->entries[i].id_next = i + 1 < oix->entry_count ? i + 1 : SPIFFS_OBJ_INDEX_NONE;
+  }
+  oix->free_head = 0;
+  oix->complete = 1;
+}
+
+// Reads the page of an entry and checks that it is still the valid object
+// index header of the entry's object. Returns SPIFFS_ERR_NOT_FOUND if not.
+static s32_t spiffs_obj_index_read_hdr(
+    spiffs *fs,
+    spiffs_obj_index_entry *e,
+    spiffs_page_object_ix_header *objix_hdr) {
+  s32_t res;
+  res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_LU2 | SPIFFS_OP_C_READ,
+      0, SPIFFS_PAGE_TO_PADDR(fs, e->pix), sizeof(spiffs_page_object_ix_header), (u8_t *)objix_hdr);
+  SPIFFS_CHECK_RES(res);
+  if (objix_hdr->p_hdr.obj_id == e->obj_id &&
+      objix_hdr->p_hdr.span_ix == 0 &&
+      (objix_hdr->p_hdr.flags & (SPIFFS_PH_FLAG_DELET | SPIFFS_PH_FLAG_FINAL | SPIFFS_PH_FLAG_USED | SPIFFS_PH_FLAG_IXDELE)) ==
+          (SPIFFS_PH_FLAG_DELET | SPIFFS_PH_FLAG_IXDELE)) {
+    return SPIFFS_OK;
+  }
+  return SPIFFS_ERR_NOT_FOUND;
+}
+
+s32_t spiffs_obj_index_init(spiffs *fs, void *buf, u32_t buf_size) {
+  spiffs_obj_index *oix;
+  u32_t entries;
+  u32_t buckets;
+  u8_t ptr_size = sizeof(void*);
+  u8_t addr_lsb = ((u8_t)(intptr_t)buf) & (ptr_size-1);
+
+  fs->obj_index = 0;
+  // align index pointer to pointer size byte boundary
+  if (addr_lsb) {
+    if (buf_size < (u32_t)(ptr_size-addr_lsb)) {
+      return SPIFFS_ERR_OBJ_INDEX_MEM;
+    }
+    buf = (u8_t *)buf + (ptr_size-addr_lsb);
+    buf_size -= (ptr_size-addr_lsb);
+  }
+  if (buf_size < SPIFFS_OBJ_INDEX_MEM_SIZE(fs->block_count, 1)) {
+    return SPIFFS_ERR_OBJ_INDEX_MEM;
+  }
+
+  entries = (buf_size - SPIFFS_OBJ_INDEX_MEM_SIZE(fs->block_count, 0)) /
+      (sizeof(spiffs_obj_index_entry) + 2*sizeof(u16_t));
+  entries = MIN(entries, SPIFFS_OBJ_INDEX_NONE - 1);
+  buckets = 1;
+  while (buckets * 2 <= entries) {
+    buckets *= 2;
+  }
+
+  oix = (spiffs_obj_index *)buf;
+  oix->entry_count = entries;
+  oix->hash_mask = buckets - 1;
+  oix->block_free = (u16_t *)((u8_t *)buf + sizeof(spiffs_obj_index));
+  oix->entries = (spiffs_obj_index_entry *)&oix->block_free[fs->block_count];
+  oix->id_hash = (u16_t *)&oix->entries[entries];
+  oix->name_hash = &oix->id_hash[buckets];
+  spiffs_obj_index_clear(oix);
+
+  fs->obj_index = oix;
+  return SPIFFS_OK;
+}
+
+static s32_t spiffs_obj_index_build_v(
+    spiffs *fs,
+    spiffs_obj_id obj_id,
+    spiffs_block_ix bix,
+    int ix_entry,
+    const void *user_const_p,
+    void *user_var_p) {
+  (void)user_const_p;
+  (void)user_var_p;
+  s32_t res;
+  spiffs_obj_index *oix = spiffs_get_obj_index(fs);
+  spiffs_obj_index_entry e;
+  spiffs_page_object_ix_header objix_hdr;
+
+  if (obj_id == SPIFFS_OBJ_ID_FREE) {
+    oix->block_free[bix]++;
+  } else if (obj_id != SPIFFS_OBJ_ID_DELETED && (obj_id & SPIFFS_OBJ_ID_IX_FLAG)) {
+    e.obj_id = obj_id;
+    e.pix = SPIFFS_OBJ_LOOKUP_ENTRY_TO_PIX(fs, bix, ix_entry);
+    res = spiffs_obj_index_read_hdr(fs, &e, &objix_hdr);
+    if (res == SPIFFS_OK) {
+      spiffs_obj_index_update(fs, obj_id, e.pix, objix_hdr.name);
+    } else if (res != SPIFFS_ERR_NOT_FOUND) {
+      return res;
+    }
+  }
+  return SPIFFS_VIS_COUNTINUE;
+}
+
+// Builds the index by scanning all object lookup pages
+s32_t spiffs_obj_index_build(spiffs *fs) {
+  s32_t res;
+  spiffs_block_ix bix;
+  spiffs_obj_index *oix = spiffs_get_obj_index(fs);
+  if (oix == 0) return SPIFFS_OK;
+
+  spiffs_obj_index_clear(oix);
+  for (bix = 0; bix < fs->block_count; bix++) {
+    oix->block_free[bix] = 0;
+  }
+
+  res = spiffs_obj_lu_find_entry_visitor(fs, 0, 0, 0, 0, spiffs_obj_index_build_v, 0, 0, 0, 0);
+  if (res == SPIFFS_VIS_END) {
+    res = SPIFFS_OK;
+  }
+  SPIFFS_DBG("obj index: built, complete:"_SPIPRIi"\n", oix->complete);
+  return res;
+}
+
+// Adds or moves the object index header of an object. Name may be null if
+// the name did not change.
+void spiffs_obj_index_update(spiffs *fs, spiffs_obj_id obj_id, spiffs_page_ix pix, const u8_t *name) {
+  spiffs_obj_index *oix = spiffs_get_obj_index(fs);
+  spiffs_obj_index_entry *e;
+  u16_t ix;
+  if (oix == 0) return;
+
+  obj_id |= SPIFFS_OBJ_ID_IX_FLAG;
+  e = spiffs_obj_index_get(oix, obj_id);
+  if (e) {
+    ix = e - oix->entries;
+    e->pix = pix;
+    if (name) {
+      spiffs_obj_index_name_unlink(oix, ix);
+      spiffs_obj_index_name_link(oix, ix, spiffs_obj_index_hash(name));
+    }
+    return;
+  }
+
+  if (name == 0 || oix->free_head == SPIFFS_OBJ_INDEX_NONE) {
+    // cannot index this object, name lookups must scan from now on
+    oix->complete = 0;
+    return;
+  }
+
+  ix = oix->free_head;
+  e = &oix->entries[ix];
+  oix->free_head = e->id_next;
+  e->obj_id = obj_id;
+  e->pix = pix;
+  e->id_next = oix->id_hash[obj_id & oix->hash_mask];
+  oix->id_hash[obj_id & oix->hash_mask] = ix;
+  spiffs_obj_index_name_link(oix, ix, spiffs_obj_index_hash(name));
+}
+
+// Removes a deleted object
+void spiffs_obj_index_remove(spiffs *fs, spiffs_obj_id obj_id) {
+  spiffs_obj_index *oix = spiffs_get_obj_index(fs);
+  u16_t *link;
+  u16_t ix;
+  if (oix == 0) return;
+
+  obj_id |= SPIFFS_OBJ_ID_IX_FLAG;
+  link = &oix->id_hash[obj_id & oix->hash_mask];
+  while ((ix = *link) != SPIFFS_OBJ_INDEX_NONE) {
+    spiffs_obj_index_entry *e = &oix->entries[ix];
+    if (e->obj_id == obj_id) {
+      *link = e->id_next;
+      spiffs_obj_index_name_unlink(oix, ix);
+      e->obj_id = SPIFFS_OBJ_ID_FREE;
+      e->id_next = oix->free_head;
+      oix->free_head = ix;
+      return;
+    }
+    link = &e->id_next;
+  }
+}
+
+// Finds the object index header page of an object. Returns SPIFFS_VIS_END if
+// the index cannot tell, the caller must scan then.
+s32_t spiffs_obj_index_find_by_id(spiffs *fs, spiffs_obj_id obj_id, spiffs_page_ix *pix) {
+  s32_t res;
+  spiffs_obj_index *oix = spiffs_get_obj_index(fs);
+  spiffs_obj_index_entry *e;
+  spiffs_page_object_ix_header objix_hdr;
+  if (oix == 0) return SPIFFS_VIS_END;
+
+  e = spiffs_obj_index_get(oix, obj_id | SPIFFS_OBJ_ID_IX_FLAG);
+  if (e == 0) return SPIFFS_VIS_END;
+  res = spiffs_obj_index_read_hdr(fs, e, &objix_hdr);
+  if (res == SPIFFS_ERR_NOT_FOUND) return SPIFFS_VIS_END;
+  SPIFFS_CHECK_RES(res);
+  *pix = e->pix;
+  return SPIFFS_OK;
+}
+
+// Finds the object index header page of an object by name. Returns
+// SPIFFS_ERR_NOT_FOUND if there is no such object and SPIFFS_VIS_END if the
+// index cannot tell, the caller must scan then.
+s32_t spiffs_obj_index_find_by_name(spiffs *fs, const u8_t name[SPIFFS_OBJ_NAME_LEN], spiffs_page_ix *pix) {
+  s32_t res;
+  spiffs_obj_index *oix = spiffs_get_obj_index(fs);
+  spiffs_page_object_ix_header objix_hdr;
+  u16_t name_hash;
+  u16_t ix;
+  u8_t stale = 0;
+  if (oix == 0) return SPIFFS_VIS_END;
+
+  name_hash = spiffs_obj_index_hash(name);
+  ix = oix->name_hash[name_hash & oix->hash_mask];
+  while (ix != SPIFFS_OBJ_INDEX_NONE) {
+    spiffs_obj_index_entry *e = &oix->entries[ix];
+    if (e->name_hash == name_hash) {
+      res = spiffs_obj_index_read_hdr(fs, e, &objix_hdr);
+      if (res == SPIFFS_OK) {
+        if (strcmp((const char *)name, (const char *)objix_hdr.name) == 0) {
+          *pix = e->pix;
+          return SPIFFS_OK;
+        }
+      } else if (res == SPIFFS_ERR_NOT_FOUND) {
+        stale = 1;
+      } else {
+        return res;
+      }
+    }
+    ix = e->name_next;
+  }
+  return (oix->complete && !stale) ? SPIFFS_ERR_NOT_FOUND : SPIFFS_VIS_END;
+}
+
+// Moves a free page search start past blocks without free pages
+void spiffs_obj_index_skip_full_blocks(spiffs *fs, spiffs_block_ix *bix, int *lu_entry) {
+  spiffs_obj_index *oix = spiffs_get_obj_index(fs);
+  spiffs_block_ix cur_block = *bix;
+  int cur_entry = *lu_entry;
+  u32_t i;
+  if (oix == 0) return;
+
+  if (cur_entry > (int)SPIFFS_OBJ_LOOKUP_MAX_ENTRIES(fs) - 1) {
+    cur_entry = 0;
+    cur_block++;
+  }
+  for (i = 0; i < fs->block_count; i++) {
+    if (cur_block >= fs->block_count) {
+      cur_block = 0;
+    }
+    if (oix->block_free[cur_block] > 0) {
+      *bix = cur_block;
+      *lu_entry = cur_entry;
+      return;
+    }
+    cur_entry = 0;
+    cur_block++;
+  }
+  // no free pages according to the index, leave it to the full search
+}
+
+void spiffs_obj_index_page_allocated(spiffs *fs, spiffs_block_ix bix) {
+  spiffs_obj_index *oix = spiffs_get_obj_index(fs);
+  if (oix == 0) return;
+  if (oix->block_free[bix] > 0) {
+    oix->block_free[bix]--;
+  }
+}
+
+void spiffs_obj_index_block_erased(spiffs *fs, spiffs_block_ix bix) {
+  spiffs_obj_index *oix = spiffs_get_obj_index(fs);
+  if (oix == 0) return;
+  oix->block_free[bix] = SPIFFS_OBJ_LOOKUP_MAX_ENTRIES(fs);
+}
+
+#endif // SPIFFS_OBJ_INDEX
@@ -13,6 +13,7 @@
 
 
 #include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 
 #include <string.h>
 #include <stdio.h>
@@ -23,6 +24,7 @@
 
 #include "esp_vfs.h"
 #include "esp_attr.h"
+#include "esp_timer.h"
 #include <errno.h>
 
 #include <spiffs_vfs.h>
@@ -42,6 +44,33 @@
 
 #define SPIFFS_ERASE_SIZE 4096
 
+#ifdef CONFIG_SPIFFS_CACHE_PAGES
+#define SPIFFS_CACHE_PAGES CONFIG_SPIFFS_CACHE_PAGES
+#else
+#define SPIFFS_CACHE_PAGES 32
+#endif
+
+#ifdef CONFIG_SPIFFS_OBJ_INDEX_ENTRIES
+#define SPIFFS_OBJ_INDEX_ENTRIES CONFIG_SPIFFS_OBJ_INDEX_ENTRIES
+#else
+#define SPIFFS_OBJ_INDEX_ENTRIES 64
+#endif
+
+#ifdef CONFIG_SPIFFS_GC_FREE_BLOCKS
+#define SPIFFS_GC_FREE_BLOCKS CONFIG_SPIFFS_GC_FREE_BLOCKS
+#else
+#define SPIFFS_GC_FREE_BLOCKS 6
+#endif
+
+#ifdef CONFIG_SPIFFS_GC_TASK_PRIORITY
+#define SPIFFS_GC_TASK_PRIORITY CONFIG_SPIFFS_GC_TASK_PRIORITY
+#else
+#define SPIFFS_GC_TASK_PRIORITY 1
+#endif
+
+#define SPIFFS_GC_TASK_STACK 2048
+#define SPIFFS_GC_TASK_PERIOD_MS 1000
+
 int spiffs_is_registered = 0;
 int spiffs_is_mounted = 0;
 
@@ -81,6 +110,11 @@ static struct list files;
 static u8_t *my_spiffs_work_buf;
 static u8_t *my_spiffs_fds;
 static u8_t *my_spiffs_cache;
+static u8_t *my_spiffs_obj_index = NULL;
+
+static TaskHandle_t spiffs_gc_task_handle = NULL;
+static spiffs_latency_stat_t spiffs_latency;
+static portMUX_TYPE spiffs_latency_mux = portMUX_INITIALIZER_UNLOCKED;
 
 
 /*
@@ -98,6 +132,86 @@ void spiffs_fs_stat(uint32_t *total, uint32_t *used) {
 	}
 }
 
+//----------------------------------------------------------------------------
+void spiffs_cache_stat(uint32_t *hits, uint32_t *misses, uint32_t *evictions) {
+#if SPIFFS_CACHE && SPIFFS_CACHE_STATS
+	*hits = fs.cache_hits;
+	*misses = fs.cache_misses;
+	*evictions = fs.cache_evictions;
+#else
+	*hits = 0;
+	*misses = 0;
+	*evictions = 0;
+#endif
+}
+
+//--------------------------------------------------------
+static void spiffs_latency_add(uint32_t *hist, uint32_t us) {
+	int n = 0;
+
+	while ((n < SPIFFS_LATENCY_BUCKETS - 1) && (us >> n)) n++;
+	hist[n]++;
+}
+
+//---------------------------------------------------
+void spiffs_latency_stat(spiffs_latency_stat_t *stat) {
+	portENTER_CRITICAL(&spiffs_latency_mux);
+	*stat = spiffs_latency;
+	portEXIT_CRITICAL(&spiffs_latency_mux);
+}
+
+//-----------------------------
+void spiffs_latency_reset(void) {
+	portENTER_CRITICAL(&spiffs_latency_mux);
+	memset(&spiffs_latency, 0, sizeof(spiffs_latency));
+	portEXIT_CRITICAL(&spiffs_latency_mux);
+}
+
+// Returns an upper bound in us for the latency of permille/1000 of the writes
+//-------------------------------------------------------------------------------------
+uint32_t spiffs_latency_percentile(const spiffs_latency_stat_t *stat, uint32_t permille) {
+	uint32_t limit = (uint64_t)stat->write_count * permille / 1000;
+	uint32_t count = 0;
+	int n;
+
+	for (n = 0; n < SPIFFS_LATENCY_BUCKETS; n++) {
+		count += stat->write_hist[n];
+		if (count > limit) break;
+	}
+	if (n >= SPIFFS_LATENCY_BUCKETS - 1) return stat->write_max_us;
+	return ((uint32_t)1 << n) - 1;
+}
+
+/*
+ * Background garbage collector.
+ * Keeps SPIFFS_GC_FREE_BLOCKS blocks free, one step per SPIFFS_LOCK, so that
+ * writes do not run the garbage collector themselves. Woken up by writes when
+ * free blocks run low, and periodically.
+ */
+//-----------------------------------------
+static void spiffs_gc_task(void *pvParameters) {
+	int64_t t0;
+	uint32_t us;
+
+	while (1) {
+		ulTaskNotifyTake(pdTRUE, SPIFFS_GC_TASK_PERIOD_MS / portTICK_PERIOD_MS);
+
+		while (spiffs_is_mounted) {
+			t0 = esp_timer_get_time();
+			if (SPIFFS_gc_step(&fs, SPIFFS_GC_FREE_BLOCKS) != SPIFFS_OK) break;
+			us = esp_timer_get_time() - t0;
+
+			portENTER_CRITICAL(&spiffs_latency_mux);
+			spiffs_latency.gc_steps++;
+			if (us > spiffs_latency.gc_step_max_us) spiffs_latency.gc_step_max_us = us;
+			portEXIT_CRITICAL(&spiffs_latency_mux);
+
+			// let waiting writers in between the steps
+			vTaskDelay(1);
+		}
+	}
+}
+
 /*
  * Test if path corresponds to a directory. Return 0 if is not a directory,
  * 1 if it's a directory.
@@ -280,7 +394,20 @@ static size_t IRAM_ATTR vfs_spiffs_write(int fd, const void *data, size_t size)
     }
 
     // Write SPIFFS file
+	int64_t t0 = esp_timer_get_time();
 	res = SPIFFS_write(&fs, file->spiffs_file, (void *)data, size);
+	uint32_t us = esp_timer_get_time() - t0;
+
+	portENTER_CRITICAL(&spiffs_latency_mux);
+	spiffs_latency.write_count++;
+	if (us > spiffs_latency.write_max_us) spiffs_latency.write_max_us = us;
+	spiffs_latency_add(spiffs_latency.write_hist, us);
+	portEXIT_CRITICAL(&spiffs_latency_mux);
+
+	if ((spiffs_gc_task_handle) && (fs.free_blocks < SPIFFS_GC_FREE_BLOCKS)) {
+		xTaskNotifyGive(spiffs_gc_task_handle);
+	}
+
 	if (res >= 0) {
 		return res;
 	} else {
@@ -752,7 +879,7 @@ int spiffs_mount() {
     	goto err_exit;
     }
 
-    int cache_len = cfg.log_page_size * SPIFFS_TEMPORAL_CACHE_HIT_SCORE;
+    int cache_len = SPIFFS_CACHE_MEM_SIZE(cfg.log_page_size, SPIFFS_CACHE_PAGES);
     my_spiffs_cache = malloc(cache_len);
     if (!my_spiffs_cache) {
         free(my_spiffs_work_buf);
@@ -764,7 +891,7 @@ int spiffs_mount() {
     ESP_LOGI(tag, "Start address: 0x%x; Size %d KB", cfg.phys_addr, cfg.phys_size / 1024);
     ESP_LOGI(tag, "  Work buffer: %d B", cfg.log_page_size * 8);
     ESP_LOGI(tag, "   FDS buffer: %d B", sizeof(spiffs_fd) * SPIFFS_TEMPORAL_CACHE_HIT_SCORE);
-    ESP_LOGI(tag, "   Cache size: %d B", cfg.log_page_size * SPIFFS_TEMPORAL_CACHE_HIT_SCORE);
+    ESP_LOGI(tag, "   Cache size: %d B (%d pages)", cache_len, SPIFFS_CACHE_PAGES);
     while (retries < 2) {
 		res = SPIFFS_mount(
 				&fs, &cfg, my_spiffs_work_buf, my_spiffs_fds,
@@ -804,6 +931,35 @@ int spiffs_mount() {
 		goto exit;
     }
 
+#if SPIFFS_OBJ_INDEX
+    if (SPIFFS_OBJ_INDEX_ENTRIES > 0) {
+        int obj_index_len = SPIFFS_OBJ_INDEX_MEM_SIZE(fs.block_count, SPIFFS_OBJ_INDEX_ENTRIES);
+        my_spiffs_obj_index = malloc(obj_index_len);
+        if (!my_spiffs_obj_index) {
+            ESP_LOGW(tag, "No memory for object index, files are found by scanning");
+        }
+        else if (SPIFFS_obj_index(&fs, my_spiffs_obj_index, obj_index_len) != SPIFFS_OK) {
+            ESP_LOGW(tag, "Error building object index (%d)", fs.err_code);
+            free(my_spiffs_obj_index);
+            my_spiffs_obj_index = NULL;
+        }
+        else {
+            ESP_LOGI(tag, " Object index: %d B (%d files)", obj_index_len, SPIFFS_OBJ_INDEX_ENTRIES);
+        }
+    }
+#endif
+
+    if ((SPIFFS_GC_FREE_BLOCKS > 0) && (spiffs_gc_task_handle == NULL)) {
+        if (xTaskCreate(&spiffs_gc_task, "spiffs_gc", SPIFFS_GC_TASK_STACK, NULL,
+                SPIFFS_GC_TASK_PRIORITY, &spiffs_gc_task_handle) != pdPASS) {
+            spiffs_gc_task_handle = NULL;
+            ESP_LOGW(tag, "Error creating GC task, garbage is collected on write");
+        }
+        else {
+            ESP_LOGI(tag, "      GC task: keeps %d blocks free", SPIFFS_GC_FREE_BLOCKS);
+        }
+    }
+
     list_init(&files, 0);
 
     ESP_LOGI(tag, "Mounted");
@@ -870,6 +1026,11 @@ int spiffs_unmount(int unreg) {
 	SPIFFS_unmount(&fs);
     spiffs_is_mounted = 0;
 
+    if (my_spiffs_obj_index) {
+        free(my_spiffs_obj_index);
+        my_spiffs_obj_index = NULL;
+    }
+
     if (unreg) {
     	esp_vfs_unregister("/spiffs");
     	spiffs_is_registered = 0;
@@ -13,6 +13,18 @@
 
 #define SPIFFS_BASE_PATH "/spiffs"
 
+// number of log2 buckets of the write latency histogram
+#define SPIFFS_LATENCY_BUCKETS 24
+
+typedef struct {
+	uint32_t write_count;
+	uint32_t write_max_us;
+	// write_hist[n] counts the writes taking less than 2^n us
+	uint32_t write_hist[SPIFFS_LATENCY_BUCKETS];
+	uint32_t gc_steps;
+	uint32_t gc_step_max_us;
+} spiffs_latency_stat_t;
+
 
 int spiffs_is_registered;
 int spiffs_is_mounted;
@@ -21,3 +33,7 @@ void vfs_spiffs_register();
 int spiffs_mount();
 int spiffs_unmount(int unreg);
 void spiffs_fs_stat(uint32_t *total, uint32_t *used);
+void spiffs_cache_stat(uint32_t *hits, uint32_t *misses, uint32_t *evictions);
+void spiffs_latency_stat(spiffs_latency_stat_t *stat);
+void spiffs_latency_reset(void);
+uint32_t spiffs_latency_percentile(const spiffs_latency_stat_t *stat, uint32_t permille);
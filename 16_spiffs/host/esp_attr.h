@@ -0,0 +1,10 @@
+/*
+ * Host build: ESP32 attributes
+ */
+
+#ifndef HOST_ESP_ATTR_H_
+#define HOST_ESP_ATTR_H_
+
+#define IRAM_ATTR
+
+#endif /* HOST_ESP_ATTR_H_ */
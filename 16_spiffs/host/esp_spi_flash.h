@@ -0,0 +1,20 @@
+/*
+ * Host build: SPI flash API of ESP-IDF, implemented by the host program.
+ * Like on the ESP32, address, size and RAM buffer of spi_flash_read and
+ * spi_flash_write must be 4 byte aligned.
+ */
+
+#ifndef HOST_ESP_SPI_FLASH_H_
+#define HOST_ESP_SPI_FLASH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int esp_err_t;
+
+esp_err_t spi_flash_read(size_t src_addr, void *dest, size_t size);
+esp_err_t spi_flash_write(size_t dest_addr, const void *src, size_t size);
+esp_err_t spi_flash_erase_range(size_t start_addr, size_t size);
+esp_err_t spi_flash_erase_sector(size_t sector);
+
+#endif /* HOST_ESP_SPI_FLASH_H_ */
@@ -0,0 +1,160 @@
+/*
+ * Flash I/O benchmark for esp_spiffs.c (host build)
+ *
+ * Runs the access pattern of SPIFFS (small unaligned lookup and header
+ * reads, page reads and writes, flag updates, block erases) against a RAM
+ * flash with NOR semantics (writes only clear bits) and checks the result
+ * against a shadow copy. Reports the number of heap calls, the number of
+ * spi_flash_* calls and the time per operation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_spiffs.h"
+#include "esp_spi_flash.h"
+
+#define FLASH_SIZE  (1024*1024)
+#define PAGE_SIZE   256
+#define BLOCK_SIZE  8192
+#define OPS         1000000
+
+static uint8_t flash[FLASH_SIZE];
+static uint8_t shadow[FLASH_SIZE];
+
+static unsigned long heap_calls;
+static unsigned long flash_calls;
+static unsigned long flash_errors;
+
+// heap calls are counted with the --wrap linker option
+void *__real_malloc(size_t size);
+void __real_free(void *ptr);
+void *__real_realloc(void *ptr, size_t size);
+void *__real_calloc(size_t n, size_t size);
+
+void *__wrap_malloc(size_t size) { heap_calls++; return __real_malloc(size); }
+void __wrap_free(void *ptr) { heap_calls++; __real_free(ptr); }
+void *__wrap_realloc(void *ptr, size_t size) { heap_calls++; return __real_realloc(ptr, size); }
+void *__wrap_calloc(size_t n, size_t size) { heap_calls++; return __real_calloc(n, size); }
+
+static int is_aligned(size_t addr, const void *buf, size_t size) {
+	return ((addr | (size_t)buf | size) & 3) == 0;
+}
+
+esp_err_t spi_flash_read(size_t src_addr, void *dest, size_t size) {
+	flash_calls++;
+	if (!is_aligned(src_addr, dest, size) || src_addr + size > FLASH_SIZE) {
+		flash_errors++;
+		return -1;
+	}
+	memcpy(dest, flash + src_addr, size);
+	return 0;
+}
+
+esp_err_t spi_flash_write(size_t dest_addr, const void *src, size_t size) {
+	const uint8_t *s = src;
+	size_t i;
+
+	flash_calls++;
+	if (!is_aligned(dest_addr, src, size) || dest_addr + size > FLASH_SIZE) {
+		flash_errors++;
+		return -1;
+	}
+	for (i = 0; i < size; i++) {
+		flash[dest_addr + i] &= s[i];
+	}
+	return 0;
+}
+
+esp_err_t spi_flash_erase_range(size_t start_addr, size_t size) {
+	flash_calls++;
+	if ((start_addr % 4096) || (size % 4096) || start_addr + size > FLASH_SIZE) {
+		flash_errors++;
+		return -1;
+	}
+	memset(flash + start_addr, 0xff, size);
+	return 0;
+}
+
+esp_err_t spi_flash_erase_sector(size_t sector) {
+	return spi_flash_erase_range(sector * 4096, 4096);
+}
+
+static double get_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(void) {
+	static uint8_t buf_mem[PAGE_SIZE + 8];
+	uint8_t *buf;
+	u32_t addr, size, i;
+	unsigned long op, errors = 0;
+	double t;
+	int kind;
+
+	memset(flash, 0xff, sizeof(flash));
+	memset(shadow, 0xff, sizeof(shadow));
+	srand(1);
+
+	heap_calls = 0;
+	t = get_ns();
+	for (op = 0; op < OPS; op++) {
+		// SPIFFS work buffers are not always aligned
+		buf = buf_mem + (rand() & 3);
+		kind = rand() % 100;
+		if (kind < 40) {
+			// object lookup entry
+			addr = (rand() % (FLASH_SIZE / 2)) * 2;
+			size = 2;
+		} else if (kind < 70) {
+			// page header
+			addr = (rand() % (FLASH_SIZE / PAGE_SIZE)) * PAGE_SIZE;
+			size = 5 + (rand() & 1);
+		} else {
+			// data
+			addr = rand() % (FLASH_SIZE - PAGE_SIZE);
+			size = 1 + rand() % PAGE_SIZE;
+		}
+
+		if (kind % 10 == 9) {
+			// write: clear some bits
+			for (i = 0; i < size; i++) {
+				buf[i] = ~(1 << (rand() & 7));
+				shadow[addr + i] &= buf[i];
+			}
+			if (esp32_spi_flash_write(addr, size, buf) != SPIFFS_OK) {
+				errors++;
+			}
+		} else if (kind == 0 && op % 64 == 0) {
+			// block erase (two sectors)
+			addr = (rand() % (FLASH_SIZE / BLOCK_SIZE)) * BLOCK_SIZE;
+			memset(shadow + addr, 0xff, BLOCK_SIZE);
+			if (esp32_spi_flash_erase(addr, BLOCK_SIZE) != SPIFFS_OK) {
+				errors++;
+			}
+		} else {
+			if (esp32_spi_flash_read(addr, size, buf) != SPIFFS_OK ||
+					memcmp(buf, shadow + addr, size) != 0) {
+				errors++;
+			}
+		}
+	}
+	t = get_ns() - t;
+
+	if (memcmp(flash, shadow, FLASH_SIZE) != 0) {
+		errors++;
+	}
+
+	printf("operations:        %d\n", OPS);
+	printf("heap calls:        %lu\n", heap_calls);
+	printf("spi_flash calls:   %lu (%.2f per operation)\n", flash_calls, (double)flash_calls / OPS);
+	printf("alignment errors:  %lu\n", flash_errors);
+	printf("ns per operation:  %.1f\n", t / OPS);
+	printf("data errors:       %lu\n", errors);
+
+	return (errors == 0 && flash_errors == 0) ? 0 : 1;
+}
@@ -0,0 +1,15 @@
+/*
+ * Host build: minimal FreeRTOS definitions needed by spiffs_config.h
+ */
+
+#ifndef HOST_FREERTOS_H_
+#define HOST_FREERTOS_H_
+
+typedef void *QueueHandle_t;
+
+#define portMAX_DELAY 0xffffffff
+
+#define xSemaphoreTake(sem, ticks) (1)
+#define xSemaphoreGive(sem) (1)
+
+#endif /* HOST_FREERTOS_H_ */
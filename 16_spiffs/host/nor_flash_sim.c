@@ -0,0 +1,149 @@
+/*
+ * Host build: NOR flash simulator behind the ESP-IDF SPI flash API
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "esp_spi_flash.h"
+#include "nor_flash_sim.h"
+
+static nor_flash_config_t config;
+static nor_flash_stat_t flash_stat;
+static uint8_t *flash = NULL;
+static uint32_t *sector_erases = NULL;
+static int flash_fd = -1;
+
+int nor_flash_init(const nor_flash_config_t *cfg) {
+	config = *cfg;
+	memset(&flash_stat, 0, sizeof(flash_stat));
+
+	if ((config.size == 0) || (config.sector_size == 0) || (config.size % config.sector_size)) {
+		fprintf(stderr, "nor_flash: size must be a multiple of the sector size\n");
+		return -1;
+	}
+
+	sector_erases = calloc(config.size / config.sector_size, sizeof(uint32_t));
+	if (!sector_erases) return -1;
+
+	if (config.file) {
+		// keeps the content between runs, a new file starts erased
+		flash_fd = open(config.file, O_RDWR | O_CREAT, 0644);
+		if (flash_fd < 0) {
+			perror(config.file);
+			return -1;
+		}
+		off_t old_size = lseek(flash_fd, 0, SEEK_END);
+		if (ftruncate(flash_fd, config.size) != 0) {
+			perror(config.file);
+			return -1;
+		}
+		flash = mmap(NULL, config.size, PROT_READ | PROT_WRITE, MAP_SHARED, flash_fd, 0);
+		if (flash == MAP_FAILED) {
+			flash = NULL;
+			perror(config.file);
+			return -1;
+		}
+		if (old_size < (off_t)config.size) {
+			memset(flash + old_size, 0xff, config.size - old_size);
+		}
+	}
+	else {
+		flash = malloc(config.size);
+		if (!flash) return -1;
+		memset(flash, 0xff, config.size);
+	}
+	return 0;
+}
+
+void nor_flash_deinit(void) {
+	if (config.file) {
+		if (flash) munmap(flash, config.size);
+		if (flash_fd >= 0) close(flash_fd);
+	}
+	else {
+		free(flash);
+	}
+	free(sector_erases);
+	flash = NULL;
+	sector_erases = NULL;
+	flash_fd = -1;
+}
+
+uint64_t nor_flash_time_ns(void) {
+	return flash_stat.time_ns;
+}
+
+void nor_flash_get_stat(nor_flash_stat_t *s) {
+	*s = flash_stat;
+}
+
+void nor_flash_get_wear(uint32_t *max_erases, uint32_t *min_erases) {
+	uint32_t i;
+
+	*max_erases = 0;
+	*min_erases = UINT32_MAX;
+	for (i = 0; i < config.size / config.sector_size; i++) {
+		if (sector_erases[i] > *max_erases) *max_erases = sector_erases[i];
+		if (sector_erases[i] < *min_erases) *min_erases = sector_erases[i];
+	}
+}
+
+// like spi_flash_read/write on the ESP32: address, size and buffer 4 byte aligned
+static int nor_flash_check(size_t addr, const void *buf, size_t size) {
+	if (((addr | (size_t)buf | size) & 3) || (addr + size > config.size)) {
+		flash_stat.errors++;
+		return -1;
+	}
+	return 0;
+}
+
+esp_err_t spi_flash_read(size_t src_addr, void *dest, size_t size) {
+	if (nor_flash_check(src_addr, dest, size)) return -1;
+
+	memcpy(dest, flash + src_addr, size);
+	flash_stat.reads++;
+	flash_stat.read_bytes += size;
+	flash_stat.time_ns += config.read_op_ns + (uint64_t)config.read_byte_ns * size;
+	return 0;
+}
+
+esp_err_t spi_flash_write(size_t dest_addr, const void *src, size_t size) {
+	const uint8_t *s = src;
+	size_t i;
+
+	if (nor_flash_check(dest_addr, src, size)) return -1;
+
+	// NOR flash can not set bits by programming
+	for (i = 0; i < size; i++) flash[dest_addr + i] &= s[i];
+	flash_stat.progs++;
+	flash_stat.prog_bytes += size;
+	flash_stat.time_ns += config.prog_op_ns + (uint64_t)config.prog_byte_ns * size;
+	return 0;
+}
+
+esp_err_t spi_flash_erase_range(size_t start_addr, size_t size) {
+	size_t addr;
+
+	if ((start_addr % config.sector_size) || (size % config.sector_size) ||
+			(start_addr + size > config.size)) {
+		flash_stat.errors++;
+		return -1;
+	}
+
+	for (addr = start_addr; addr < start_addr + size; addr += config.sector_size) {
+		memset(flash + addr, 0xff, config.sector_size);
+		sector_erases[addr / config.sector_size]++;
+		flash_stat.erases++;
+		flash_stat.time_ns += config.erase_ns;
+	}
+	return 0;
+}
+
+esp_err_t spi_flash_erase_sector(size_t sector) {
+	return spi_flash_erase_range(sector * config.sector_size, config.sector_size);
+}
@@ -0,0 +1,56 @@
+/*
+ * Host build: NOR flash simulator behind the ESP-IDF SPI flash API
+ *
+ * The flash content lives in RAM or in a mmap'ed file. Like NOR flash,
+ * programming can only clear bits and erasing sets a whole sector to 0xff.
+ * Every operation adds its configured duration to a simulated clock, so
+ * benchmarks are repeatable and independent of the host speed.
+ */
+
+#ifndef HOST_NOR_FLASH_SIM_H_
+#define HOST_NOR_FLASH_SIM_H_
+
+#include <stdint.h>
+
+typedef struct {
+	uint32_t size;			// flash size in bytes
+	uint32_t sector_size;	// erase sector size in bytes
+	uint32_t read_op_ns;	// time per read command
+	uint32_t read_byte_ns;	// time per byte read
+	uint32_t prog_op_ns;	// time per program command
+	uint32_t prog_byte_ns;	// time per byte programmed
+	uint32_t erase_ns;		// time per sector erase
+	const char *file;		// backing file, NULL for RAM
+} nor_flash_config_t;
+
+typedef struct {
+	uint64_t time_ns;		// simulated time
+	uint64_t reads;
+	uint64_t read_bytes;
+	uint64_t progs;
+	uint64_t prog_bytes;
+	uint64_t erases;		// sector erases
+	uint64_t errors;		// rejected unaligned or out of range calls
+} nor_flash_stat_t;
+
+// Timing of a typical 40 MHz QIO SPI flash on the ESP32
+#define NOR_FLASH_CONFIG_DEFAULT(flash_size) { \
+	.size = (flash_size), \
+	.sector_size = 4096, \
+	.read_op_ns = 10000, \
+	.read_byte_ns = 50, \
+	.prog_op_ns = 20000, \
+	.prog_byte_ns = 2700, \
+	.erase_ns = 45000000, \
+	.file = NULL, \
+}
+
+int nor_flash_init(const nor_flash_config_t *cfg);
+void nor_flash_deinit(void);
+
+uint64_t nor_flash_time_ns(void);
+void nor_flash_get_stat(nor_flash_stat_t *stat);
+// erase count of the most and the least erased sector
+void nor_flash_get_wear(uint32_t *max_erases, uint32_t *min_erases);
+
+#endif /* HOST_NOR_FLASH_SIM_H_ */
@@ -0,0 +1,384 @@
+/*
+ * SPIFFS throughput and wear benchmark (host build)
+ *
+ * Runs SPIFFS with the ESP32 flash layer (esp_spiffs.c) on the NOR flash
+ * simulator. Each scenario starts on a freshly formatted file system and
+ * reports, in simulated time:
+ *
+ *   MB/s        file bytes written or read per second
+ *   p99         99th percentile latency of one operation
+ *   erases      sector erases
+ *   wamp        write amplification, bytes programmed per file byte written
+ *
+ * usage: spiffs_benchmark [-f flash_file] [-s size_kb] [-b block_size] [-g free_blocks]
+ *
+ *   -f  back the flash with a mmap'ed file instead of RAM
+ *   -s  flash size in KB (default 1024)
+ *   -b  SPIFFS logical block size (default 8192)
+ *   -g  run SPIFFS_gc_step between operations, like the GC task of
+ *       spiffs_vfs.c, keeping this many blocks free (default 0, off)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "spiffs.h"
+#include "spiffs_nucleus.h"
+#include "esp_spiffs.h"
+#include "nor_flash_sim.h"
+
+#define LOG_PAGE_SIZE	256
+#define CACHE_PAGES		32
+#define OBJ_INDEX_FILES	64
+#define FDS				8
+#define MAX_OPS			50000
+
+static spiffs fs;
+static spiffs_config cfg;
+static u8_t work_buf[LOG_PAGE_SIZE * 2];
+static u8_t fds_buf[FDS * sizeof(spiffs_fd)];
+static u8_t cache_buf[SPIFFS_CACHE_MEM_SIZE(LOG_PAGE_SIZE, CACHE_PAGES)];
+static u8_t *obj_index_buf;
+static u32_t obj_index_size;
+static u32_t nor_flash_size;
+static u32_t log_block_size = 8192;
+static u32_t gc_free_blocks = 0;
+
+static uint64_t op_ns[MAX_OPS];
+static int op_count;
+static uint64_t user_written;
+static uint64_t user_read;
+static unsigned long errors;
+
+static nor_flash_stat_t start_stat;
+static uint64_t start_ns;
+
+static u8_t buf[4096];
+
+//-----------------------------
+static void fill(u8_t *p, u32_t len, u32_t seed) {
+	u32_t i;
+
+	for (i = 0; i < len; i++) p[i] = (u8_t)((seed + i) * 2654435761u >> 24);
+}
+
+//------------------------------------------
+static int check(const u8_t *p, u32_t len, u32_t seed) {
+	u32_t i;
+
+	for (i = 0; i < len; i++) {
+		if (p[i] != (u8_t)((seed + i) * 2654435761u >> 24)) return 0;
+	}
+	return 1;
+}
+
+//------------------------
+static void fs_config(void) {
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.phys_size = nor_flash_size;
+	cfg.phys_addr = 0;
+	cfg.phys_erase_block = 4096;
+	cfg.log_block_size = log_block_size;
+	cfg.log_page_size = LOG_PAGE_SIZE;
+	cfg.hal_read_f = esp32_spi_flash_read;
+	cfg.hal_write_f = (spiffs_write)esp32_spi_flash_write;
+	cfg.hal_erase_f = esp32_spi_flash_erase;
+}
+
+//----------------------
+static int fs_mount(void) {
+	if (SPIFFS_mount(&fs, &cfg, work_buf, fds_buf, sizeof(fds_buf),
+			cache_buf, sizeof(cache_buf), NULL) != SPIFFS_OK) {
+		return -1;
+	}
+	return SPIFFS_obj_index(&fs, obj_index_buf, obj_index_size);
+}
+
+// Formats and mounts a fresh file system
+//---------------------------
+static int fs_format(void) {
+	if (SPIFFS_mounted(&fs)) SPIFFS_unmount(&fs);
+	fs_config();
+	// mount to initialize the fs struct for formatting
+	SPIFFS_mount(&fs, &cfg, work_buf, fds_buf, sizeof(fds_buf), cache_buf, sizeof(cache_buf), NULL);
+	SPIFFS_unmount(&fs);
+	if (SPIFFS_format(&fs) != SPIFFS_OK) return -1;
+	return fs_mount();
+}
+
+//----------------------------
+static void scenario_begin(void) {
+	op_count = 0;
+	user_written = 0;
+	user_read = 0;
+	nor_flash_get_stat(&start_stat);
+	start_ns = nor_flash_time_ns();
+}
+
+// One file system operation, measured in simulated time
+#define OP(expr) do { \
+	uint64_t _t0 = nor_flash_time_ns(); \
+	if ((expr) < 0) errors++; \
+	if (op_count < MAX_OPS) op_ns[op_count++] = nor_flash_time_ns() - _t0; \
+	if (gc_free_blocks) while (SPIFFS_gc_step(&fs, gc_free_blocks) == SPIFFS_OK); \
+} while (0)
+
+//---------------------------------------------
+static int cmp_u64(const void *a, const void *b) {
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+	return (x > y) - (x < y);
+}
+
+//---------------------------------------------
+static void scenario_end(const char *name) {
+	nor_flash_stat_t st;
+	uint64_t ns;
+	uint64_t busy_ns = 0;
+	double mb;
+	int i;
+
+	nor_flash_get_stat(&st);
+	ns = nor_flash_time_ns() - start_ns;
+	for (i = 0; i < op_count; i++) busy_ns += op_ns[i];
+	qsort(op_ns, op_count, sizeof(op_ns[0]), cmp_u64);
+
+	// throughput of the operations, without background garbage collection
+	mb = (double)(user_written + user_read) / (1024 * 1024);
+	printf("%-14s %6d ops %8.3f MB/s  p99 %9.2f ms  max %9.2f ms  erases %6lu  wamp %6.2f  (%.1f s)\n",
+			name, op_count,
+			busy_ns ? mb / (busy_ns / 1e9) : 0.0,
+			op_count ? op_ns[op_count * 99 / 100] / 1e6 : 0.0,
+			op_count ? op_ns[op_count - 1] / 1e6 : 0.0,
+			(unsigned long)(st.erases - start_stat.erases),
+			user_written ? (double)(st.prog_bytes - start_stat.prog_bytes) / user_written : 0.0,
+			ns / 1e9);
+}
+
+// One 256 KB file, written and read in 1 KB chunks
+//--------------------------------
+static void bench_sequential(void) {
+	spiffs_file fh;
+	u32_t off;
+	const u32_t size = 256 * 1024;
+
+	fs_format();
+	scenario_begin();
+	fh = SPIFFS_open(&fs, "seq.bin", SPIFFS_CREAT | SPIFFS_TRUNC | SPIFFS_RDWR, 0);
+	for (off = 0; off < size; off += 1024) {
+		fill(buf, 1024, off);
+		OP(SPIFFS_write(&fs, fh, buf, 1024));
+		user_written += 1024;
+	}
+	OP(SPIFFS_close(&fs, fh));
+	scenario_end("seq write");
+
+	scenario_begin();
+	fh = SPIFFS_open(&fs, "seq.bin", SPIFFS_RDONLY, 0);
+	for (off = 0; off < size; off += 1024) {
+		OP(SPIFFS_read(&fs, fh, buf, 1024));
+		if (!check(buf, 1024, off)) errors++;
+		user_read += 1024;
+	}
+	SPIFFS_close(&fs, fh);
+	scenario_end("seq read");
+}
+
+// 256 byte writes and reads at random offsets of a 128 KB file
+//----------------------------
+static void bench_random(void) {
+	spiffs_file fh;
+	u32_t off;
+	int i;
+	const u32_t size = 128 * 1024;
+
+	fs_format();
+	fh = SPIFFS_open(&fs, "rnd.bin", SPIFFS_CREAT | SPIFFS_TRUNC | SPIFFS_RDWR, 0);
+	for (off = 0; off < size; off += 1024) {
+		fill(buf, 1024, off);
+		SPIFFS_write(&fs, fh, buf, 1024);
+	}
+
+	scenario_begin();
+	for (i = 0; i < 2000; i++) {
+		off = (rand() % (size / 256)) * 256;
+		fill(buf, 256, off);
+		SPIFFS_lseek(&fs, fh, off, SPIFFS_SEEK_SET);
+		OP(SPIFFS_write(&fs, fh, buf, 256));
+		user_written += 256;
+	}
+	OP(SPIFFS_fflush(&fs, fh));
+	scenario_end("random write");
+
+	scenario_begin();
+	for (i = 0; i < 5000; i++) {
+		off = rand() % (size - 256);
+		SPIFFS_lseek(&fs, fh, off, SPIFFS_SEEK_SET);
+		OP(SPIFFS_read(&fs, fh, buf, 256));
+		if (!check(buf, 256, off)) errors++;
+		user_read += 256;
+	}
+	SPIFFS_close(&fs, fh);
+	scenario_end("random read");
+}
+
+// Creating, then opening and reading many small files
+//---------------------------------
+static s32_t write_file(const char *name, u32_t len, u32_t seed) {
+	spiffs_file fh;
+	s32_t res;
+
+	fh = SPIFFS_open(&fs, name, SPIFFS_CREAT | SPIFFS_TRUNC | SPIFFS_RDWR, 0);
+	if (fh < 0) return fh;
+	fill(buf, len, seed);
+	res = SPIFFS_write(&fs, fh, buf, len);
+	SPIFFS_close(&fs, fh);
+	return res;
+}
+
+//---------------------------------
+static s32_t read_file(const char *name, u32_t len, u32_t seed) {
+	spiffs_file fh;
+	s32_t res;
+
+	fh = SPIFFS_open(&fs, name, SPIFFS_RDONLY, 0);
+	if (fh < 0) return fh;
+	res = SPIFFS_read(&fs, fh, buf, len);
+	SPIFFS_close(&fs, fh);
+	if (res != (s32_t)len || !check(buf, len, seed)) return -1;
+	return res;
+}
+
+//--------------------------------
+static void bench_small_files(void) {
+	char name[32];
+	int i;
+
+	fs_format();
+	scenario_begin();
+	for (i = 0; i < 300; i++) {
+		sprintf(name, "www/small_%d.txt", i);
+		OP(write_file(name, 200, i));
+		user_written += 200;
+	}
+	scenario_end("small create");
+
+	scenario_begin();
+	for (i = 0; i < 3000; i++) {
+		int f = rand() % 300;
+		sprintf(name, "www/small_%d.txt", f);
+		OP(read_file(name, 200, f));
+		user_read += 200;
+	}
+	scenario_end("small read");
+}
+
+// 64 byte log records, flushed each, rotated over 4 files of 32 KB
+//-------------------------------
+static void bench_append_log(void) {
+	char name[16];
+	spiffs_file fh;
+	u32_t size = 0;
+	int cur = 0;
+	int i;
+
+	fs_format();
+	scenario_begin();
+	fh = SPIFFS_open(&fs, "log0", SPIFFS_CREAT | SPIFFS_APPEND | SPIFFS_RDWR, 0);
+	for (i = 0; i < 20000; i++) {
+		fill(buf, 64, i);
+		OP(SPIFFS_write(&fs, fh, buf, 64));
+		OP(SPIFFS_fflush(&fs, fh));
+		user_written += 64;
+		size += 64;
+		if (size >= 32 * 1024) {
+			SPIFFS_close(&fs, fh);
+			cur = (cur + 1) % 4;
+			sprintf(name, "log%d", cur);
+			SPIFFS_remove(&fs, name);
+			fh = SPIFFS_open(&fs, name, SPIFFS_CREAT | SPIFFS_APPEND | SPIFFS_RDWR, 0);
+			size = 0;
+		}
+	}
+	SPIFFS_close(&fs, fh);
+	scenario_end("append log");
+}
+
+// Rewriting 4 KB files on a file system filled to about 75%
+//--------------------------------
+static void bench_gc_pressure(void) {
+	char name[32];
+	u32_t total, used;
+	int files = 0;
+	int i;
+
+	fs_format();
+	SPIFFS_info(&fs, &total, &used);
+	while (used + 4096 < total * 75 / 100) {
+		sprintf(name, "data_%d.bin", files);
+		if (write_file(name, 4096, files) < 0) break;
+		files++;
+		SPIFFS_info(&fs, &total, &used);
+	}
+
+	scenario_begin();
+	for (i = 0; i < 2000; i++) {
+		int f = rand() % files;
+		sprintf(name, "data_%d.bin", f);
+		OP(write_file(name, 4096, f + i));
+		user_written += 4096;
+		if (read_file(name, 4096, f + i) < 0) errors++;
+	}
+	scenario_end("gc pressure");
+}
+
+//--------------------------
+int main(int argc, char **argv) {
+	nor_flash_config_t flash_cfg = NOR_FLASH_CONFIG_DEFAULT(1024 * 1024);
+	uint32_t max_erases, min_erases;
+	nor_flash_stat_t st;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "f:s:b:g:")) != -1) {
+		switch (opt) {
+			case 'f': flash_cfg.file = optarg; break;
+			case 's': flash_cfg.size = atoi(optarg) * 1024; break;
+			case 'b': log_block_size = atoi(optarg); break;
+			case 'g': gc_free_blocks = atoi(optarg); break;
+			default:
+				fprintf(stderr, "usage: %s [-f flash_file] [-s size_kb] [-b block_size] [-g free_blocks]\n", argv[0]);
+				return 2;
+		}
+	}
+	nor_flash_size = flash_cfg.size;
+
+	if (nor_flash_init(&flash_cfg) != 0) return 1;
+	obj_index_size = SPIFFS_OBJ_INDEX_MEM_SIZE(nor_flash_size / log_block_size, OBJ_INDEX_FILES);
+	obj_index_buf = malloc(obj_index_size);
+	srand(1);
+
+	printf("flash %u KB, block %u B, page %u B, cache %u pages, gc task %s\n",
+			nor_flash_size / 1024, log_block_size, LOG_PAGE_SIZE, CACHE_PAGES,
+			gc_free_blocks ? "on" : "off");
+
+	bench_sequential();
+	bench_random();
+	bench_small_files();
+	bench_append_log();
+	bench_gc_pressure();
+
+	if (SPIFFS_check(&fs) != SPIFFS_OK) errors++;
+	SPIFFS_unmount(&fs);
+
+	nor_flash_get_stat(&st);
+	nor_flash_get_wear(&max_erases, &min_erases);
+	printf("sector erases: max %u min %u, flash errors %lu, data errors %lu\n",
+			max_erases, min_erases,
+			(unsigned long)st.errors, errors);
+
+	nor_flash_deinit();
+	free(obj_index_buf);
+	return (errors == 0 && st.errors == 0) ? 0 : 1;
+}
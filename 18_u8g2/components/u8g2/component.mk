@@ -1,2 +1,4 @@
 COMPONENT_SRCDIRS:=csrc
-COMPONENT_ADD_INCLUDEDIRS:=csrc
\ No newline at end of file
+COMPONENT_ADD_INCLUDEDIRS:=csrc
+# the ESP32 I2C driver has no buffer limit: send one SSD13xx tile row per transfer
+CFLAGS += -DU8X8_I2C_DATA_CHUNK_SIZE=128
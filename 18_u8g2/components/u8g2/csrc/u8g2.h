@@ -130,12 +130,81 @@
 #define U8G2_WITH_UNICODE
 
 
+/*
+  The following macro adds the glyph index to the u8g2 structure.
+  The glyph index is only built if a RAM area has been assigned with
+  u8g2_SetGlyphIndexBuffer(). In this case u8g2_SetFont() will store the
+  position of the glyphs in this RAM area. Glyphs are then found with a 
+  table lookup (glyphs 0..255) or a binary search (unicode glyphs) instead 
+  of the linear search through the font.
+  Without RAM area, the linear search is used, so this macro only costs
+  a few bytes of RAM and some flash memory.
+*/
+#define U8G2_WITH_GLYPH_INDEX
+
+
+/*
+  The following macro enables a faster glyph decoder for unrotated text
+  (font direction 0 and U8G2_R0) with u8g2_ll_hvline_vertical_top_lsb (SSD13xx, UC17xx).
+  If a glyph is completly inside the current buffer, the run length
+  encoded spans are written directly into the tile buffer. The clipping 
+  and the callback procedures of u8g2_DrawHVLine are not used for such glyphs.
+  All other glyphs are drawn with u8g2_DrawHVLine.
+*/
+#define U8G2_WITH_GLYPH_SPAN_DRAW
+
+
+/*
+  The following macro adds the glyph cache to the u8g2 structure.
+  The glyph cache is only used if a RAM area has been assigned with 
+  u8g2_SetGlyphCache(). Decoded glyphs are then stored as bitmap in this
+  RAM area and the least recently used glyph is replaced if the cache is full.
+  Cached glyphs are copied into the tile buffer without decoding the font data,
+  if the same conditions as for U8G2_WITH_GLYPH_SPAN_DRAW are met.
+*/
+#define U8G2_WITH_GLYPH_CACHE
+
+
+/*
+  The following macro enables the span fill procedures for boxes, discs and 
+  polygons without rotation (U8G2_R0). Boxes are written directly into the 
+  tile buffer:
+  u8g2_ll_hvline_vertical_top_lsb: The bit mask of a tile row is calculated 
+  once and applied to all bytes of the box in this tile row.
+  u8g2_ll_hvline_horizontal_right_lsb: The masks for the first and the last 
+  byte of a pixel row are calculated once, the bytes in between are set 
+  with memset.
+  Discs are drawn as columns or rows, whichever is the faster span for the 
+  buffer layout. All other cases are drawn with u8g2_DrawHVLine.
+*/
+#define U8G2_WITH_SPAN_FILL
+
+
+/*
+  The following macro enables the dirty tile tracking for full buffer mode.
+  For each tile row of the buffer, the ll_hvline procedures remember the 
+  first and last tile which has been modified. u8g2_UpdateDisplay() will 
+  only transfer these tiles to the display. 
+  U8G2_DIRTY_TILE_ROWS is the number of tile rows which are tracked, all 
+  other tile rows are always transfered by u8g2_UpdateDisplay().
+  This requires 2*U8G2_DIRTY_TILE_ROWS bytes of RAM in the u8g2 structure.
+*/
+#define U8G2_WITH_DIRTY_TILES
+#define U8G2_DIRTY_TILE_ROWS 16
+
+
 /*
   Internal performance test for the effect of enabling U8G2_WITH_INTERSECTION
   Should not be defined for production code
 */
 //#define U8G2_WITH_HVLINE_COUNT
 
+/*
+  Internal performance test: count the calls to u8g2_font_get_glyph_data()
+  Should not be defined for production code
+*/
+//#define U8G2_WITH_GLYPH_LOOKUP_COUNT
+
 /*
   Defining the following variable adds the clipping and check procedures agains the display boundaries.
   Clipping procedures are mandatory for the picture loop (u8g2_FirstPage/NextPage).
@@ -271,6 +340,59 @@ struct _u8g2_kerning_t
 };
 typedef struct _u8g2_kerning_t u8g2_kerning_t;
 
+#ifdef U8G2_WITH_GLYPH_INDEX
+/* one entry of the unicode part of the glyph index */
+struct _u8g2_glyph_index_entry_t
+{
+  uint32_t offset;		/* position of the glyph, relative to the first glyph of the font */
+  uint16_t encoding;
+};
+typedef struct _u8g2_glyph_index_entry_t u8g2_glyph_index_entry_t;
+#endif /* U8G2_WITH_GLYPH_INDEX */
+
+#ifdef U8G2_WITH_GLYPH_CACHE
+/* header of one glyph cache slot, followed by the bitmap of the glyph */
+/* bitmap: vertical bytes, lsb on top, (height+7)/8 rows with width bytes each */
+struct _u8g2_glyph_cache_entry_t
+{
+  const uint8_t *font;		/* NULL: unused slot */
+  const uint8_t *glyph_data;	/* return value of u8g2_font_get_glyph_data() */
+  uint32_t last_use;		/* value of u8g2->glyph_cache_tick at the last access */
+  uint16_t encoding;
+  int8_t x;			/* glyph offsets, see u8g2_font_decode_glyph() */
+  int8_t y;
+  int8_t delta_x;
+  uint8_t width;
+  uint8_t height;
+};
+typedef struct _u8g2_glyph_cache_entry_t u8g2_glyph_cache_entry_t;
+#endif /* U8G2_WITH_GLYPH_CACHE */
+
+/* one vertex of a polygon, the vertex list is owned by the user, see u8g2_InitPolygon() */
+/* all members except x and y are used by u8g2_FillPolygon() for the edge to the next vertex */
+struct _u8g2_pg_vertex_t
+{
+  int16_t x;
+  int16_t y;
+  int16_t y_top;		/* first scanline of the edge */
+  int16_t y_end;		/* last scanline of the edge (excluded) */
+  int16_t x_curr;		/* position on the current scanline is x_curr + err/dy */
+  int16_t x_step;		/* slope of the edge is x_step + err_step/dy */
+  uint16_t err;
+  uint16_t err_step;
+  uint16_t dy;
+  uint8_t next;		/* next edge in the edge table or active edge list */
+};
+typedef struct _u8g2_pg_vertex_t u8g2_pg_vertex_t;
+
+struct _u8g2_polygon_t
+{
+  u8g2_pg_vertex_t *list;
+  uint8_t max_cnt;
+  uint8_t cnt;
+};
+typedef struct _u8g2_polygon_t u8g2_polygon_t;
+
 
 struct u8g2_cb_struct
 {
@@ -342,10 +464,38 @@ struct u8g2_struct
 #ifdef U8G2_WITH_HVLINE_COUNT
   unsigned long hv_cnt;
 #endif /* U8G2_WITH_HVLINE_COUNT */   
+#ifdef U8G2_WITH_GLYPH_LOOKUP_COUNT
+  unsigned long glyph_lookup_cnt;
+#endif /* U8G2_WITH_GLYPH_LOOKUP_COUNT */
 #ifdef __unix__
   uint16_t last_unicode;
   const uint8_t *last_font_data;
 #endif
+#ifdef U8G2_WITH_GLYPH_INDEX
+  /* user supplied RAM area for the glyph index, NULL: glyph index not used */
+  void *glyph_index_buf;
+  size_t glyph_index_size;		/* size of glyph_index_buf in bytes */
+  /* the following variables are calculated in u8g2_SetFont() */
+  uint16_t *glyph_index_ascii;	/* 256 entries, position+1 of the glyph, 0: not available. NULL: no index */
+  u8g2_glyph_index_entry_t *glyph_index_unicode;	/* every glyph_index_step-th unicode glyph */
+  uint16_t glyph_index_unicode_cnt;	/* number of entries in glyph_index_unicode */
+  uint16_t glyph_index_step;
+#endif /* U8G2_WITH_GLYPH_INDEX */
+#ifdef U8G2_WITH_GLYPH_CACHE
+  uint8_t *glyph_cache;		/* user supplied RAM area, NULL: glyph cache not used */
+  uint16_t glyph_cache_cnt;		/* number of slots */
+  uint16_t glyph_cache_slot_size;	/* size of one slot in bytes (header + bitmap) */
+  uint16_t glyph_cache_bitmap_size;	/* max bitmap size of a glyph in bytes */
+  uint32_t glyph_cache_tick;
+  uint32_t glyph_cache_hit;
+  uint32_t glyph_cache_miss;
+#endif /* U8G2_WITH_GLYPH_CACHE */
+#ifdef U8G2_WITH_DIRTY_TILES
+  /* modified tiles for each tile row of the buffer: dirty_x0 <= tile < dirty_x1 */
+  /* dirty_x0 > dirty_x1: the tile row has not been modified */
+  uint8_t dirty_x0[U8G2_DIRTY_TILE_ROWS];
+  uint8_t dirty_x1[U8G2_DIRTY_TILE_ROWS];
+#endif /* U8G2_WITH_DIRTY_TILES */
 
 };
 
@@ -804,6 +954,17 @@ void u8g2_Setup_a2printer_384x240_f(u8g2_t *u8g2, const u8g2_cb_t *rotation, u8x
 void u8g2_SendBuffer(u8g2_t *u8g2);
 void u8g2_ClearBuffer(u8g2_t *u8g2);
 
+#ifdef U8G2_WITH_DIRTY_TILES
+/* tx0 <= tile column < tx1, ty0 <= tile row < ty1, tile rows are relative to the buffer */
+void u8g2_update_dirty_tiles(u8g2_t *u8g2, uint8_t tx0, uint8_t tx1, uint8_t ty0, uint8_t ty1);
+void u8g2_SetBufferDirty(u8g2_t *u8g2);
+void u8g2_UpdateDisplay(u8g2_t *u8g2);
+#endif /* U8G2_WITH_DIRTY_TILES */
+
+/* double buffering in full buffer mode */
+uint8_t *u8g2_SwapBuffer(u8g2_t *u8g2, uint8_t *buf);
+void u8g2_SendTileBuffer(u8g2_t *u8g2, const uint8_t *buf);
+
 void u8g2_SetBufferCurrTileRow(u8g2_t *u8g2, uint8_t row) U8G2_NOINLINE;
 
 void u8g2_FirstPage(u8g2_t *u8g2);
@@ -812,6 +973,7 @@ uint8_t u8g2_NextPage(u8g2_t *u8g2);
 #define u8g2_GetBufferPtr(u8g2) ((u8g2)->tile_buf_ptr)
 #define u8g2_GetBufferTileHeight(u8g2)	((u8g2)->tile_buf_height)
 #define u8g2_GetBufferTileWidth(u8g2)	(u8g2_GetU8x8(u8g2)->display_info->tile_width)
+#define u8g2_GetBufferSize(u8g2) ((size_t)u8g2_GetBufferTileHeight(u8g2) * u8g2_GetBufferTileWidth(u8g2) * 8)
 /* the following variable is only valid after calling u8g2_FirstPage */
 /* renamed from Page to Buffer: the CurrTileRow is the current row of the buffer, issue #370 */
 #define u8g2_GetPageCurrTileRow(u8g2) ((u8g2)->tile_curr_row)
@@ -833,6 +995,12 @@ void u8g2_ll_hvline_vertical_top_lsb(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t y,
 /* ST7920 */
 void u8g2_ll_hvline_horizontal_right_lsb(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t len, uint8_t dir);
 
+#ifdef U8G2_WITH_SPAN_FILL
+/* fill a box within the local buffer, w and h must not be 0, all clipping done */
+void u8g2_ll_box_vertical_top_lsb(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w, u8g2_uint_t h);
+void u8g2_ll_box_horizontal_right_lsb(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w, u8g2_uint_t h);
+#endif /* U8G2_WITH_SPAN_FILL */
+
 
 /*==========================================*/
 /* u8g2_hvline.c */
@@ -883,6 +1051,9 @@ void u8g2_DrawLine(u8g2_t *u8g2, u8g2_uint_t x1, u8g2_uint_t y1, u8g2_uint_t x2,
 
 /*==========================================*/
 /* u8g2_box.c */
+#ifdef U8G2_WITH_SPAN_FILL
+uint8_t u8g2_span_fill_box(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w, u8g2_uint_t h);
+#endif /* U8G2_WITH_SPAN_FILL */
 void u8g2_DrawBox(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w, u8g2_uint_t h);
 void u8g2_DrawFrame(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w, u8g2_uint_t h);
 void u8g2_DrawRBox(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w, u8g2_uint_t h, u8g2_uint_t r);
@@ -891,6 +1062,11 @@ void u8g2_DrawRFrame(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w,
 
 /*==========================================*/
 /* u8g2_polygon.c */
+void u8g2_InitPolygon(u8g2_polygon_t *pg, u8g2_pg_vertex_t *list, uint8_t max_cnt);
+void u8g2_ClearPolygon(u8g2_polygon_t *pg);
+uint8_t u8g2_AddPolygonVertex(u8g2_polygon_t *pg, int16_t x, int16_t y);
+void u8g2_FillPolygon(u8g2_t *u8g2, u8g2_polygon_t *pg);
+/* old API with a static vertex list (6 vertices), not reentrant */
 void u8g2_ClearPolygonXY(void);
 void u8g2_AddPolygonXY(u8g2_t *u8g2, int16_t x, int16_t y);
 void u8g2_DrawPolygon(u8g2_t *u8g2);
@@ -915,6 +1091,31 @@ size_t u8g2_GetFontSize(const uint8_t *font_arg);
 #define U8G2_FONT_HEIGHT_MODE_ALL 2
 
 void u8g2_SetFont(u8g2_t *u8g2, const uint8_t  *font);
+#ifdef U8G2_WITH_GLYPH_INDEX
+/*
+  buf:		RAM area for the glyph index (32 bit aligned) or NULL to disable the index
+  size:		size of buf in bytes, at least 512 bytes. 
+		512 bytes are used for glyphs 0..255, 8 bytes for each indexed unicode glyph.
+		If the area is too small for all unicode glyphs, only every n-th glyph 
+		is indexed and the remaining glyphs are found with a short linear search.
+		With exactly 512 bytes, unicode glyphs use the linear search of the font.
+*/
+void u8g2_SetGlyphIndexBuffer(u8g2_t *u8g2, void *buf, size_t size);
+#endif /* U8G2_WITH_GLYPH_INDEX */
+#ifdef U8G2_WITH_GLYPH_CACHE
+/*
+  buf:		RAM area for the glyph cache (32 bit aligned) or NULL to disable the cache
+  size:		size of buf in bytes
+  bitmap_size:	max size of a cached glyph in bytes: width*((height+7)/8)
+		Larger glyphs are not cached.
+  Each slot requires sizeof(u8g2_glyph_cache_entry_t)+bitmap_size bytes (rounded up to 4).
+  This will also clear the cache and the hit/miss counters.
+*/
+void u8g2_SetGlyphCache(u8g2_t *u8g2, void *buf, size_t size, uint16_t bitmap_size);
+void u8g2_ClearGlyphCache(u8g2_t *u8g2);
+#define u8g2_GetGlyphCacheHits(u8g2) ((u8g2)->glyph_cache_hit)
+#define u8g2_GetGlyphCacheMisses(u8g2) ((u8g2)->glyph_cache_miss)
+#endif /* U8G2_WITH_GLYPH_CACHE */
 void u8g2_SetFontMode(u8g2_t *u8g2, uint8_t is_transparent);
 
 uint8_t u8g2_IsGlyph(u8g2_t *u8g2, uint16_t requested_encoding);
@@ -35,6 +35,58 @@
 
 #include "u8g2.h"
 
+#ifdef U8G2_WITH_SPAN_FILL
+/*
+  clip a (included) to a+len (excluded) against c (included) to d (excluded)
+  a+len < a: the range starts left of 0 (wrap around, like u8g2_DrawHVLine)
+  returns the length of the clipped range and updates a
+*/
+static u8g2_uint_t u8g2_span_clip(u8g2_uint_t *ap, u8g2_uint_t len, u8g2_uint_t c, u8g2_uint_t d)
+{
+  u8g2_uint_t a = *ap;
+  u8g2_uint_t b = a;
+  
+  b += len;
+  if ( a > b || a < c )
+    a = c;
+  if ( b > d )
+    b = d;
+  if ( a >= b )
+    return 0;
+  *ap = a;
+  return b - a;
+}
+
+/*
+  Fill a box directly in the tile buffer, see U8G2_WITH_SPAN_FILL. 
+  The box is clipped against the clip box of the user.
+  Returns 0 if the display is rotated or the buffer layout is not supported,
+  nothing is drawn in this case.
+*/
+uint8_t u8g2_span_fill_box(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w, u8g2_uint_t h)
+{
+  if ( u8g2->cb != &u8g2_cb_r0 )
+    return 0;
+  if ( u8g2->ll_hvline != u8g2_ll_hvline_vertical_top_lsb && u8g2->ll_hvline != u8g2_ll_hvline_horizontal_right_lsb )
+    return 0;
+  
+  /* without rotation, the clip box of the user is inside the tile buffer */
+  w = u8g2_span_clip(&x, w, u8g2->user_x0, u8g2->user_x1);
+  if ( w == 0 )
+    return 1;
+  h = u8g2_span_clip(&y, h, u8g2->user_y0, u8g2->user_y1);
+  if ( h == 0 )
+    return 1;
+  y -= u8g2->pixel_curr_row;
+  
+  if ( u8g2->ll_hvline == u8g2_ll_hvline_vertical_top_lsb )
+    u8g2_ll_box_vertical_top_lsb(u8g2, x, y, w, h);
+  else
+    u8g2_ll_box_horizontal_right_lsb(u8g2, x, y, w, h);
+  return 1;
+}
+#endif /* U8G2_WITH_SPAN_FILL */
+
 /*
   draw a filled box
   restriction: does not work for w = 0 or h = 0
@@ -45,6 +97,10 @@ void u8g2_DrawBox(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w, u8g
   if ( u8g2_IsIntersection(u8g2, x, y, x+w, y+h) == 0 ) 
     return;
 #endif /* U8G2_WITH_INTERSECTION */
+#ifdef U8G2_WITH_SPAN_FILL
+  if ( u8g2_span_fill_box(u8g2, x, y, w, h) != 0 )
+    return;
+#endif /* U8G2_WITH_SPAN_FILL */
   while( h != 0 )
   { 
     u8g2_DrawHVLine(u8g2, x, y, w, 0);
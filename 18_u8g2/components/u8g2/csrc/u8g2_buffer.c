@@ -37,9 +37,96 @@
 #include <string.h>
 
 /*============================================*/
+#ifdef U8G2_WITH_DIRTY_TILES
+
+static void u8g2_clear_dirty_tiles(u8g2_t *u8g2)
+{
+  memset(u8g2->dirty_x0, 255, U8G2_DIRTY_TILE_ROWS);
+  memset(u8g2->dirty_x1, 0, U8G2_DIRTY_TILE_ROWS);
+}
+
+/*
+  Mark a tile area of the buffer as modified. 
+  tx0 <= tile column < tx1, ty0 <= tile row < ty1
+  Tile rows are relative to the buffer (not the display!).
+  Called by the ll_hvline procedures.
+*/
+void u8g2_update_dirty_tiles(u8g2_t *u8g2, uint8_t tx0, uint8_t tx1, uint8_t ty0, uint8_t ty1)
+{
+  if ( ty1 > U8G2_DIRTY_TILE_ROWS )
+    ty1 = U8G2_DIRTY_TILE_ROWS;
+  while( ty0 < ty1 )
+  {
+    if ( u8g2->dirty_x0[ty0] > tx0 )
+      u8g2->dirty_x0[ty0] = tx0;
+    if ( u8g2->dirty_x1[ty0] < tx1 )
+      u8g2->dirty_x1[ty0] = tx1;
+    ty0++;
+  }
+}
+
+/* 
+  Mark the complete buffer as modified, so that the next u8g2_UpdateDisplay()
+  will transfer all tiles. Use this after writing to the buffer directly.
+*/
+void u8g2_SetBufferDirty(u8g2_t *u8g2)
+{
+  u8g2_update_dirty_tiles(u8g2, 0, u8g2_GetU8x8(u8g2)->display_info->tile_width, 0, u8g2->tile_buf_height);
+}
+
+/*
+  Before the buffer is cleared, all tiles with pixels are marked as modified,
+  because these tiles will change on the display.
+*/
+static void u8g2_update_dirty_tiles_before_clear(u8g2_t *u8g2)
+{
+  uint8_t *ptr;
+  uint16_t row_size;
+  uint16_t first, last, i;
+  uint8_t w;
+  uint8_t row;
+  
+  w = u8g2_GetU8x8(u8g2)->display_info->tile_width;
+  row_size = w;
+  row_size *= 8;
+  ptr = u8g2->tile_buf_ptr;
+  for( row = 0; row < u8g2->tile_buf_height && row < U8G2_DIRTY_TILE_ROWS; row++ )
+  {
+    first = row_size;
+    last = 0;
+    for( i = 0; i < row_size; i++ )
+    {
+      if ( ptr[i] != 0 )
+      {
+	if ( first == row_size )
+	  first = i;
+	last = i;
+      }
+    }
+    if ( first < row_size )
+    {
+      if ( u8g2->ll_hvline == u8g2_ll_hvline_vertical_top_lsb )
+      {
+	/* the 8 bytes of a tile are next to each other */
+	u8g2_update_dirty_tiles(u8g2, first>>3, (last>>3)+1, row, row+1);
+      }
+      else
+      {
+	u8g2_update_dirty_tiles(u8g2, 0, w, row, row+1);
+      }
+    }
+    ptr += row_size;
+  }
+}
+
+#endif /* U8G2_WITH_DIRTY_TILES */
+
 void u8g2_ClearBuffer(u8g2_t *u8g2)
 {
   size_t cnt;
+#ifdef U8G2_WITH_DIRTY_TILES
+  u8g2_update_dirty_tiles_before_clear(u8g2);
+#endif /* U8G2_WITH_DIRTY_TILES */
   cnt = u8g2_GetU8x8(u8g2)->display_info->tile_width;
   cnt *= u8g2->tile_buf_height;
   cnt *= 8;
@@ -87,6 +174,9 @@ static void u8g2_send_buffer(u8g2_t *u8g2)
     src_row++;
     dest_row++;
   } while( src_row < src_max && dest_row < dest_max );
+#ifdef U8G2_WITH_DIRTY_TILES
+  u8g2_clear_dirty_tiles(u8g2);
+#endif /* U8G2_WITH_DIRTY_TILES */
 }
 
 /* same as u8g2_send_buffer but also send the DISPLAY_REFRESH message (used by SSD1606) */
@@ -96,6 +186,101 @@ void u8g2_SendBuffer(u8g2_t *u8g2)
   u8x8_RefreshDisplay( u8g2_GetU8x8(u8g2) );  
 }
 
+#ifdef U8G2_WITH_DIRTY_TILES
+/* 
+  Same as u8g2_SendBuffer, but only transfer the tiles, which have been 
+  modified since the last transfer. Intended for the full buffer mode:
+  If only a small part of the screen changes (for example the digits 
+  of a clock), only this part is sent to the display.
+  Tile rows above U8G2_DIRTY_TILE_ROWS are always transfered.
+*/
+void u8g2_UpdateDisplay(u8g2_t *u8g2)
+{
+  uint8_t *ptr;
+  uint8_t src_row;
+  uint8_t src_max;
+  uint8_t dest_row;
+  uint8_t dest_max;
+  uint8_t w;
+  uint8_t x0, x1;
+
+  w = u8g2_GetU8x8(u8g2)->display_info->tile_width;
+  src_row = 0;
+  src_max = u8g2->tile_buf_height;
+  dest_row = u8g2->tile_curr_row;
+  dest_max = u8g2_GetU8x8(u8g2)->display_info->tile_height;
+  ptr = u8g2->tile_buf_ptr;
+  
+  do
+  {
+    x0 = 0;
+    x1 = w;
+    if ( src_row < U8G2_DIRTY_TILE_ROWS )
+    {
+      x0 = u8g2->dirty_x0[src_row];
+      x1 = u8g2->dirty_x1[src_row];
+      if ( x1 > w )
+	x1 = w;
+    }
+    if ( x0 < x1 )
+    {
+      u8x8_DrawTile(u8g2_GetU8x8(u8g2), x0, dest_row, x1-x0, ptr + x0*8);
+    }
+    ptr += w*8;
+    src_row++;
+    dest_row++;
+  } while( src_row < src_max && dest_row < dest_max );
+  u8g2_clear_dirty_tiles(u8g2);
+  u8x8_RefreshDisplay( u8g2_GetU8x8(u8g2) );  
+}
+#endif /* U8G2_WITH_DIRTY_TILES */
+
+/*============================================*/
+/*
+  Double buffering for the full buffer mode.
+
+  u8g2_SwapBuffer:
+    Replace the tile buffer by "buf", which must have u8g2_GetBufferSize() bytes.
+    The content of the current tile buffer is copied to "buf", so that the 
+    application can continue to draw as usual. The previous tile buffer is 
+    returned and can be sent with u8g2_SendTileBuffer().
+  
+  u8g2_SendTileBuffer:
+    Same as u8g2_SendBuffer, but send "buf" instead of the current tile buffer.
+    Only the u8x8 part of the u8g2 structure is used, so this can be called
+    from another task while the application draws into the tile buffer.
+    
+  Example:
+    front = u8g2_SwapBuffer(u8g2, front);	(app task)
+    u8g2_SendTileBuffer(u8g2, front);		(flush task)
+*/
+uint8_t *u8g2_SwapBuffer(u8g2_t *u8g2, uint8_t *buf)
+{
+  uint8_t *old = u8g2->tile_buf_ptr;
+  memcpy(buf, old, u8g2_GetBufferSize(u8g2));
+  u8g2->tile_buf_ptr = buf;
+#ifdef U8G2_WITH_DIRTY_TILES
+  /* the returned buffer is sent completely */
+  u8g2_clear_dirty_tiles(u8g2);
+#endif /* U8G2_WITH_DIRTY_TILES */
+  return old;
+}
+
+void u8g2_SendTileBuffer(u8g2_t *u8g2, const uint8_t *buf)
+{
+  uint8_t row;
+  uint8_t w;
+
+  w = u8g2_GetU8x8(u8g2)->display_info->tile_width;
+  for( row = 0; row < u8g2->tile_buf_height && row < u8g2_GetU8x8(u8g2)->display_info->tile_height; row++ )
+  {
+    /* u8x8_DrawTile does not modify the tile data */
+    u8x8_DrawTile(u8g2_GetU8x8(u8g2), 0, row, w, (uint8_t *)buf);
+    buf += w*8;
+  }
+  u8x8_RefreshDisplay( u8g2_GetU8x8(u8g2) );  
+}
+
 /*============================================*/
 void u8g2_SetBufferCurrTileRow(u8g2_t *u8g2, uint8_t row)
 {
@@ -124,37 +124,102 @@ void u8g2_DrawCircle(u8g2_t *u8g2, u8g2_uint_t x0, u8g2_uint_t y0, u8g2_uint_t r
 /*==============================================*/
 /* Disk */
 
-static void u8g2_draw_disc_section(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t x0, u8g2_uint_t y0, uint8_t option) U8G2_NOINLINE;
+/*
+  The disc is drawn as columns x0-a and x0+a (a = 0..rad) with len pixel 
+  above and below the center row y0 (including y0). The four quarters 
+  of the disc are symmetric to the diagonal, so the same values also 
+  describe the rows y0-a and y0+a with len pixel left and right of x0.
+  Rows are used for u8g2_ll_hvline_horizontal_right_lsb, where the pixel 
+  of a row are in consecutive bytes.
+*/
 
-static void u8g2_draw_disc_section(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t x0, u8g2_uint_t y0, uint8_t option)
+static void u8g2_draw_disc_line(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t len, uint8_t dir)
 {
-    /* upper right */
-    if ( option & U8G2_DRAW_UPPER_RIGHT )
-    {
-      u8g2_DrawVLine(u8g2, x0+x, y0-y, y+1);
-      u8g2_DrawVLine(u8g2, x0+y, y0-x, x+1);
-    }
-    
-    /* upper left */
-    if ( option & U8G2_DRAW_UPPER_LEFT )
-    {
-      u8g2_DrawVLine(u8g2, x0-x, y0-y, y+1);
-      u8g2_DrawVLine(u8g2, x0-y, y0-x, x+1);
-    }
-    
-    /* lower right */
-    if ( option & U8G2_DRAW_LOWER_RIGHT )
+#ifdef U8G2_WITH_SPAN_FILL
+  if ( dir == 0 )
+  {
+    if ( u8g2_span_fill_box(u8g2, x, y, len, 1) != 0 )
+      return;
+  }
+  else
+  {
+    if ( u8g2_span_fill_box(u8g2, x, y, 1, len) != 0 )
+      return;
+  }
+#endif /* U8G2_WITH_SPAN_FILL */
+  if ( dir == 0 )
+    u8g2_DrawHLine(u8g2, x, y, len);
+  else
+    u8g2_DrawVLine(u8g2, x, y, len);
+}
+
+/*
+  draw one column (dir = 1) or row (dir = 0) of the disc
+  pos: x of the column or y of the row
+  c: center of the column or row
+  is_neg: draw the half above (left of) c
+  is_pos: draw the half below (right of) c
+*/
+static void u8g2_draw_disc_span(u8g2_t *u8g2, u8g2_uint_t pos, u8g2_uint_t c, u8g2_uint_t len, uint8_t is_neg, uint8_t is_pos, uint8_t dir)
+{
+  u8g2_uint_t start = c;
+  u8g2_uint_t cnt = 1;
+  
+  if ( is_neg == 0 && is_pos == 0 )
+    return;
+  len--;
+  if ( is_neg != 0 )
+  {
+    start -= len;
+    cnt += len;
+  }
+  if ( is_pos != 0 )
+    cnt += len;
+  if ( dir == 0 )
+    u8g2_draw_disc_line(u8g2, start, pos, cnt, 0);
+  else
+    u8g2_draw_disc_line(u8g2, pos, start, cnt, 1);
+}
+
+static void u8g2_draw_disc_section(u8g2_t *u8g2, u8g2_uint_t a, u8g2_uint_t len, u8g2_uint_t x0, u8g2_uint_t y0, uint8_t option) U8G2_NOINLINE;
+
+static void u8g2_draw_disc_section(u8g2_t *u8g2, u8g2_uint_t a, u8g2_uint_t len, u8g2_uint_t x0, u8g2_uint_t y0, uint8_t option)
+{
+  uint8_t is_row = 0;
+  uint8_t upper_left, upper_right, lower_left, lower_right;
+  
+#ifdef U8G2_WITH_SPAN_FILL
+  if ( u8g2->cb == &u8g2_cb_r0 && u8g2->ll_hvline == u8g2_ll_hvline_horizontal_right_lsb )
+    is_row = 1;
+#endif /* U8G2_WITH_SPAN_FILL */
+  
+  upper_left = option & U8G2_DRAW_UPPER_LEFT;
+  upper_right = option & U8G2_DRAW_UPPER_RIGHT;
+  lower_left = option & U8G2_DRAW_LOWER_LEFT;
+  lower_right = option & U8G2_DRAW_LOWER_RIGHT;
+  
+  if ( is_row != 0 )
+  {
+    if ( a == 0 )
     {
-      u8g2_DrawVLine(u8g2, x0+x, y0, y+1);
-      u8g2_DrawVLine(u8g2, x0+y, y0, x+1);
+      /* center row */
+      u8g2_draw_disc_span(u8g2, y0, x0, len, upper_left|lower_left, upper_right|lower_right, 0);
+      return;
     }
-    
-    /* lower left */
-    if ( option & U8G2_DRAW_LOWER_LEFT )
+    u8g2_draw_disc_span(u8g2, y0-a, x0, len, upper_left, upper_right, 0);
+    u8g2_draw_disc_span(u8g2, y0+a, x0, len, lower_left, lower_right, 0);
+  }
+  else
+  {
+    if ( a == 0 )
     {
-      u8g2_DrawVLine(u8g2, x0-x, y0, y+1);
-      u8g2_DrawVLine(u8g2, x0-y, y0, x+1);
+      /* center column */
+      u8g2_draw_disc_span(u8g2, x0, y0, len, upper_left|upper_right, lower_left|lower_right, 1);
+      return;
     }
+    u8g2_draw_disc_span(u8g2, x0-a, y0, len, upper_left, lower_left, 1);
+    u8g2_draw_disc_span(u8g2, x0+a, y0, len, upper_right, lower_right, 1);
+  }
 }
 
 static void u8g2_draw_disc(u8g2_t *u8g2, u8g2_uint_t x0, u8g2_uint_t y0, u8g2_uint_t rad, uint8_t option)
@@ -174,12 +239,20 @@ static void u8g2_draw_disc(u8g2_t *u8g2, u8g2_uint_t x0, u8g2_uint_t y0, u8g2_ui
   x = 0;
   y = rad;
 
-  u8g2_draw_disc_section(u8g2, x, y, x0, y0, option);
+  /* 
+    Each step of the circle algorithm draws column x with y+1 pixel. 
+    Column y is drawn with x+1 pixel before y is decremented, this is the 
+    longest length of column y. Each column is drawn only once, so that 
+    the disc can be drawn with XOR.
+  */
+  u8g2_draw_disc_section(u8g2, x, y+1, x0, y0, option);
   
   while ( x < y )
   {
     if (f >= 0) 
     {
+      if ( y > x+1 )
+	u8g2_draw_disc_section(u8g2, y, x+1, x0, y0, option);
       y--;
       ddF_y += 2;
       f += ddF_y;
@@ -188,7 +261,7 @@ static void u8g2_draw_disc(u8g2_t *u8g2, u8g2_uint_t x0, u8g2_uint_t y0, u8g2_ui
     ddF_x += 2;
     f += ddF_x;
 
-    u8g2_draw_disc_section(u8g2, x, y, x0, y0, option);    
+    u8g2_draw_disc_section(u8g2, x, y+1, x0, y0, option);    
   }
 }
 
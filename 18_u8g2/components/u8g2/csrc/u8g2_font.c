@@ -447,6 +447,153 @@ void u8g2_font_decode_len(u8g2_t *u8g2, uint8_t len, uint8_t is_foreground)
   
 }
 
+#ifdef U8G2_WITH_GLYPH_SPAN_DRAW
+/*
+  Description:
+    Same as u8g2_font_decode_len(), but the spans are written directly
+    into the tile buffer (u8g2_ll_hvline_vertical_top_lsb memory layout).
+  Assumptions:
+    font direction 0, display rotation U8G2_R0
+    the glyph is completly inside the current buffer, see u8g2_font_is_span_draw()
+  Called by:
+    u8g2_font_decode_glyph()
+*/
+static void u8g2_font_span_decode_len(u8g2_t *u8g2, uint8_t len, uint8_t is_foreground)
+{
+  uint8_t cnt;	/* total number of remaining pixels, which have to be drawn */
+  uint8_t rem; 	/* remaining pixel to the right edge of the glyph */
+  uint8_t current;	/* number of pixels, which need to be drawn for the draw procedure */
+  uint8_t lx,ly;
+  uint8_t color;
+  uint8_t mask, or_mask, xor_mask;
+  uint16_t y;
+  uint16_t offset;
+  uint8_t *ptr;
+  
+  u8g2_font_decode_t *decode = &(u8g2->font_decode);
+  
+  cnt = len;
+  lx = decode->x;
+  ly = decode->y;
+  
+  color = decode->bg_color;
+  if ( is_foreground )
+    color = decode->fg_color;
+  
+  for(;;)
+  {
+    rem = decode->glyph_width;
+    rem -= lx;
+    
+    current = rem;
+    if ( cnt < rem )
+      current = cnt;
+    
+    if ( current != 0 && ( is_foreground || decode->is_transparent == 0 ) )
+    {
+      /* y position within the buffer */
+      y = decode->target_y;
+      y -= u8g2->pixel_curr_row;
+      y += ly;
+      
+      mask = 1;
+      mask <<= y & 7;
+      or_mask = 0;
+      xor_mask = 0;
+      if ( color <= 1 )
+	or_mask  = mask;
+      if ( color != 1 )
+	xor_mask = mask;
+      
+      offset = y;
+      offset &= ~7;
+      offset *= u8g2_GetU8x8(u8g2)->display_info->tile_width;
+      offset += decode->target_x;
+      offset += lx;
+      ptr = u8g2->tile_buf_ptr;
+      ptr += offset;
+      
+      do
+      {
+	*ptr |= or_mask;
+	*ptr ^= xor_mask;
+	ptr++;
+	current--;
+      } while( current != 0 );
+    }
+    
+    if ( cnt < rem )
+      break;
+    cnt -= rem;
+    lx = 0;
+    ly++;
+  }
+  lx += cnt;
+  
+  decode->x = lx;
+  decode->y = ly;
+}
+#endif /* U8G2_WITH_GLYPH_SPAN_DRAW */
+
+#if defined(U8G2_WITH_GLYPH_SPAN_DRAW) || defined(U8G2_WITH_GLYPH_CACHE)
+/*
+  Description:
+    Check whether the current glyph can be drawn with u8g2_font_span_decode_len().
+    decode->target_x/target_y must be the upper left corner of the glyph.
+  Return:
+    1, if the glyph is unrotated and completly inside the tile buffer.
+*/
+static uint8_t u8g2_font_is_span_draw(u8g2_t *u8g2, uint8_t h)
+{
+  u8g2_font_decode_t *decode = &(u8g2->font_decode);
+  uint16_t t;
+  
+#ifdef U8G2_WITH_FONT_ROTATION
+  if ( decode->dir != 0 )
+    return 0;
+#endif
+  if ( u8g2->cb != &u8g2_cb_r0 )
+    return 0;
+  if ( u8g2->ll_hvline != u8g2_ll_hvline_vertical_top_lsb )
+    return 0;
+  
+  t = decode->target_x;
+  t += (uint8_t)decode->glyph_width;
+  if ( t > u8g2->pixel_buf_width )
+    return 0;
+  
+  if ( decode->target_y < u8g2->buf_y0 )
+    return 0;
+  t = decode->target_y;
+  t += h;
+  if ( t > u8g2->buf_y1 )
+    return 0;
+  return 1;
+}
+
+#ifdef U8G2_WITH_DIRTY_TILES
+/*
+  Description:
+    Mark the tiles of the glyph box as modified. Required for glyphs, which
+    are written into the tile buffer without u8g2_ll_hvline_vertical_top_lsb().
+  Assumptions:
+    u8g2_font_is_span_draw() returned 1
+*/
+static void u8g2_font_update_dirty_span(u8g2_t *u8g2, uint8_t h)
+{
+  u8g2_font_decode_t *decode = &(u8g2->font_decode);
+  uint16_t x1, y0, y1;
+  
+  x1 = decode->target_x;
+  x1 += (uint8_t)decode->glyph_width - 1;
+  y0 = decode->target_y;
+  y0 -= u8g2->pixel_curr_row;
+  y1 = y0 + h - 1;
+  u8g2_update_dirty_tiles(u8g2, decode->target_x>>3, (x1>>3)+1, y0>>3, (y1>>3)+1);
+}
+#endif /* U8G2_WITH_DIRTY_TILES */
+#endif /* defined(U8G2_WITH_GLYPH_SPAN_DRAW) || defined(U8G2_WITH_GLYPH_CACHE) */
+
 static void u8g2_font_setup_decode(u8g2_t *u8g2, const uint8_t *glyph_data)
 {
   u8g2_font_decode_t *decode = &(u8g2->font_decode);
@@ -557,6 +704,30 @@ int8_t u8g2_font_decode_glyph(u8g2_t *u8g2, const uint8_t *glyph_data)
     decode->x = 0;
     decode->y = 0;
     
+#ifdef U8G2_WITH_GLYPH_SPAN_DRAW
+    if ( u8g2_font_is_span_draw(u8g2, h) )
+    {
+#ifdef U8G2_WITH_DIRTY_TILES
+      u8g2_font_update_dirty_span(u8g2, h);
+#endif /* U8G2_WITH_DIRTY_TILES */
+      /* decode glyph directly into the tile buffer */
+      for(;;)
+      {
+	a = u8g2_font_decode_get_unsigned_bits(decode, u8g2->font_info.bits_per_0);
+	b = u8g2_font_decode_get_unsigned_bits(decode, u8g2->font_info.bits_per_1);
+	do
+	{
+	  u8g2_font_span_decode_len(u8g2, a, 0);
+	  u8g2_font_span_decode_len(u8g2, b, 1);
+	} while( u8g2_font_decode_get_unsigned_bits(decode, 1) != 0 );
+
+	if ( decode->y >= h )
+	  break;
+      }
+      return d;
+    }
+#endif /* U8G2_WITH_GLYPH_SPAN_DRAW */
+    
     /* decode glyph */
     for(;;)
     {
@@ -578,6 +749,196 @@ int8_t u8g2_font_decode_glyph(u8g2_t *u8g2, const uint8_t *glyph_data)
   return d;
 }
 
+#ifdef U8G2_WITH_GLYPH_INDEX
+
+/*
+  Description:
+    Build the glyph index for the current font inside the user supplied 
+    RAM area (u8g2->glyph_index_buf). 
+    The first 256 words contain the position+1 of the glyphs 0..255.
+    The remaining memory stores encoding and position of every 
+    glyph_index_step-th unicode glyph. The step is choosen so that
+    the index fits into the RAM area. 
+  Called by:
+    u8g2_SetFont()
+    u8g2_SetGlyphIndexBuffer()
+*/
+static void u8g2_font_build_glyph_index(u8g2_t *u8g2)
+{
+  const uint8_t *start;
+  const uint8_t *font;
+  uint16_t *ascii;
+  uint16_t i;
+  
+  u8g2->glyph_index_ascii = NULL;
+  u8g2->glyph_index_unicode_cnt = 0;
+  
+  if ( u8g2->font == NULL || u8g2->glyph_index_buf == NULL )
+    return;
+  if ( u8g2->glyph_index_size < 256*sizeof(uint16_t) )
+    return;
+  
+  start = u8g2->font;
+  start += U8G2_FONT_DATA_STRUCT_SIZE;
+  
+  ascii = (uint16_t *)u8g2->glyph_index_buf;
+  for( i = 0; i < 256; i++ )
+    ascii[i] = 0;
+  
+  font = start;
+  for(;;)
+  {
+    if ( u8x8_pgm_read( font + 1 ) == 0 )
+      break;
+    /* keep the first glyph, if an encoding appears twice */
+    if ( ascii[u8x8_pgm_read( font )] == 0 )
+      ascii[u8x8_pgm_read( font )] = (font - start) + 1;
+    font += u8x8_pgm_read( font + 1 );
+  }
+  
+#ifdef U8G2_WITH_UNICODE
+  {
+    u8g2_glyph_index_entry_t *unicode;
+    size_t max_cnt;
+    uint16_t e;
+    uint16_t glyph_cnt;
+    uint16_t step;
+    uint16_t cnt;
+    
+    unicode = (u8g2_glyph_index_entry_t *)(ascii + 256);
+    max_cnt = u8g2->glyph_index_size;
+    max_cnt -= 256*sizeof(uint16_t);
+    max_cnt /= sizeof(u8g2_glyph_index_entry_t);
+    
+    /* count the unicode glyphs */
+    glyph_cnt = 0;
+    font = start + u8g2->font_info.start_pos_unicode;
+    for(;;)
+    {
+      e = u8x8_pgm_read( font );
+      e <<= 8;
+      e |= u8x8_pgm_read( font + 1 );
+      if ( e == 0 )
+	break;
+      glyph_cnt++;
+      font += u8x8_pgm_read( font + 2 );
+    }
+    
+    if ( glyph_cnt > 0 && max_cnt > 0 )
+    {
+      /* step = ceil(glyph_cnt/max_cnt) */
+      step = 1;
+      if ( glyph_cnt > max_cnt )
+	step = (glyph_cnt + max_cnt - 1) / max_cnt;
+      
+      i = 0;
+      cnt = 0;
+      font = start + u8g2->font_info.start_pos_unicode;
+      for(;;)
+      {
+	e = u8x8_pgm_read( font );
+	e <<= 8;
+	e |= u8x8_pgm_read( font + 1 );
+	if ( e == 0 )
+	  break;
+	if ( i == 0 )
+	{
+	  unicode[cnt].offset = font - start;
+	  unicode[cnt].encoding = e;
+	  cnt++;
+	}
+	i++;
+	if ( i >= step )
+	  i = 0;
+	font += u8x8_pgm_read( font + 2 );
+      }
+      
+      u8g2->glyph_index_unicode = unicode;
+      u8g2->glyph_index_unicode_cnt = cnt;
+      u8g2->glyph_index_step = step;
+    }
+  }
+#endif /* U8G2_WITH_UNICODE */
+
+  u8g2->glyph_index_ascii = ascii;
+}
+
+/*
+  Description:
+    Find the starting point of the glyph data with the help of the glyph index.
+    Glyphs 0..255 are found by table lookup. For unicode glyphs, a binary search
+    returns the closest indexed glyph, followed by a linear search over at most 
+    glyph_index_step glyphs. This requires the unicode glyphs to be sorted
+    (which is always the case for fonts created by bdfconv).
+  Args:
+    encoding: Encoding (ASCII or Unicode) of the glyph
+  Return:
+    Address of the glyph data or NULL, if the encoding is not avialable in the font.
+*/
+static const uint8_t *u8g2_font_get_indexed_glyph_data(u8g2_t *u8g2, uint16_t encoding)
+{
+  const uint8_t *font = u8g2->font;
+  font += U8G2_FONT_DATA_STRUCT_SIZE;
+  
+  if ( encoding <= 255 )
+  {
+    uint16_t pos = u8g2->glyph_index_ascii[encoding];
+    if ( pos == 0 )
+      return NULL;
+    pos--;
+    return font + pos + 2;	/* skip encoding and glyph size */
+  }
+#ifdef U8G2_WITH_UNICODE
+  else
+  {
+    const u8g2_glyph_index_entry_t *unicode = u8g2->glyph_index_unicode;
+    uint16_t lo, hi, mid;
+    uint16_t cnt;
+    uint16_t e;
+    
+    if ( encoding < unicode[0].encoding )
+      return NULL;
+    
+    /* find the last entry with unicode[lo].encoding <= encoding */
+    lo = 0;
+    hi = u8g2->glyph_index_unicode_cnt;
+    while( hi - lo > 1 )
+    {
+      mid = lo + (hi - lo) / 2;
+      if ( unicode[mid].encoding <= encoding )
+	lo = mid;
+      else
+	hi = mid;
+    }
+    
+    font += unicode[lo].offset;
+    cnt = u8g2->glyph_index_step;
+    do
+    {
+      e = u8x8_pgm_read( font );
+      e <<= 8;
+      e |= u8x8_pgm_read( font + 1 );
+      if ( e == 0 || e > encoding )
+	break;
+      if ( e == encoding )
+	return font+3;	/* skip encoding and glyph size */
+      font += u8x8_pgm_read( font + 2 );
+      cnt--;
+    } while( cnt != 0 );
+  }
+#endif
+  return NULL;
+}
+
+void u8g2_SetGlyphIndexBuffer(u8g2_t *u8g2, void *buf, size_t size)
+{
+  u8g2->glyph_index_buf = buf;
+  u8g2->glyph_index_size = size;
+  u8g2_font_build_glyph_index(u8g2);
+}
+
+#endif /* U8G2_WITH_GLYPH_INDEX */
+
 /*
   Description:
     Find the starting point of the glyph data.
@@ -591,6 +952,16 @@ const uint8_t *u8g2_font_get_glyph_data(u8g2_t *u8g2, uint16_t encoding)
   const uint8_t *font = u8g2->font;
   font += U8G2_FONT_DATA_STRUCT_SIZE;
 
+#ifdef U8G2_WITH_GLYPH_LOOKUP_COUNT
+  u8g2->glyph_lookup_cnt++;
+#endif /* U8G2_WITH_GLYPH_LOOKUP_COUNT */
+
+#ifdef U8G2_WITH_GLYPH_INDEX
+  /* without space for unicode entries, only glyphs 0..255 are indexed */
+  if ( u8g2->glyph_index_ascii != NULL )
+    if ( encoding <= 255 || u8g2->glyph_index_unicode_cnt != 0 )
+      return u8g2_font_get_indexed_glyph_data(u8g2, encoding);
+#endif /* U8G2_WITH_GLYPH_INDEX */
   
   if ( encoding <= 255 )
   {
@@ -660,6 +1031,295 @@ const uint8_t *u8g2_font_get_glyph_data(u8g2_t *u8g2, uint16_t encoding)
   return NULL;
 }
 
+#ifdef U8G2_WITH_GLYPH_CACHE
+
+#define U8G2_GLYPH_CACHE_SLOT(u8g2, i) \
+  ((u8g2_glyph_cache_entry_t *)((u8g2)->glyph_cache + (size_t)(i)*(u8g2)->glyph_cache_slot_size))
+
+void u8g2_ClearGlyphCache(u8g2_t *u8g2)
+{
+  uint16_t i;
+  for( i = 0; i < u8g2->glyph_cache_cnt; i++ )
+  {
+    U8G2_GLYPH_CACHE_SLOT(u8g2, i)->font = NULL;
+    U8G2_GLYPH_CACHE_SLOT(u8g2, i)->last_use = 0;
+  }
+  u8g2->glyph_cache_tick = 0;
+  u8g2->glyph_cache_hit = 0;
+  u8g2->glyph_cache_miss = 0;
+}
+
+void u8g2_SetGlyphCache(u8g2_t *u8g2, void *buf, size_t size, uint16_t bitmap_size)
+{
+  size_t slot_size;
+  size_t cnt;
+  
+  slot_size = sizeof(u8g2_glyph_cache_entry_t);
+  slot_size += bitmap_size;
+  slot_size += sizeof(void *) - 1;
+  slot_size &= ~(sizeof(void *) - 1);
+  
+  cnt = 0;
+  if ( buf != NULL )
+    cnt = size / slot_size;
+  if ( cnt > 0xffff )
+    cnt = 0xffff;
+  
+  u8g2->glyph_cache = (uint8_t *)buf;
+  u8g2->glyph_cache_cnt = cnt;
+  u8g2->glyph_cache_slot_size = slot_size;
+  u8g2->glyph_cache_bitmap_size = bitmap_size;
+  if ( cnt == 0 )
+    u8g2->glyph_cache = NULL;
+  u8g2_ClearGlyphCache(u8g2);
+}
+
+/*
+  Description:
+    Same as u8g2_font_decode_len(), but write the foreground pixel into the 
+    bitmap of a glyph cache slot.
+*/
+static void u8g2_font_bitmap_decode_len(u8g2_font_decode_t *decode, uint8_t *bitmap, uint8_t len, uint8_t is_foreground)
+{
+  uint8_t cnt;	/* total number of remaining pixels, which have to be drawn */
+  uint8_t rem; 	/* remaining pixel to the right edge of the glyph */
+  uint8_t current;	/* number of pixels, which need to be drawn for the draw procedure */
+  uint8_t lx,ly;
+  uint8_t mask;
+  uint8_t *ptr;
+  
+  cnt = len;
+  lx = decode->x;
+  ly = decode->y;
+  
+  for(;;)
+  {
+    rem = decode->glyph_width;
+    rem -= lx;
+    
+    current = rem;
+    if ( cnt < rem )
+      current = cnt;
+    
+    if ( is_foreground && current != 0 && ly < (uint8_t)decode->glyph_height )
+    {
+      mask = 1;
+      mask <<= ly & 7;
+      ptr = bitmap;
+      ptr += (ly >> 3) * (uint16_t)decode->glyph_width;
+      ptr += lx;
+      do
+      {
+	*ptr |= mask;
+	ptr++;
+	current--;
+      } while( current != 0 );
+    }
+    
+    if ( cnt < rem )
+      break;
+    cnt -= rem;
+    lx = 0;
+    ly++;
+  }
+  lx += cnt;
+  
+  decode->x = lx;
+  decode->y = ly;
+}
+
+/*
+  Description:
+    Search the glyph in the cache. If the glyph is not found, decode the 
+    glyph into the least recently used slot.
+  Return:
+    The cache slot or NULL, if the glyph does not exist or is too large.
+*/
+static u8g2_glyph_cache_entry_t *u8g2_font_get_cached_glyph(u8g2_t *u8g2, uint16_t encoding)
+{
+  u8g2_glyph_cache_entry_t *entry;
+  u8g2_glyph_cache_entry_t *lru;
+  u8g2_font_decode_t *decode = &(u8g2->font_decode);
+  const uint8_t *glyph_data;
+  uint8_t *bitmap;
+  uint16_t bitmap_size;
+  uint16_t i;
+  uint8_t a, b, h;
+  
+  lru = U8G2_GLYPH_CACHE_SLOT(u8g2, 0);
+  for( i = 0; i < u8g2->glyph_cache_cnt; i++ )
+  {
+    entry = U8G2_GLYPH_CACHE_SLOT(u8g2, i);
+    if ( entry->font == u8g2->font && entry->encoding == encoding )
+    {
+      u8g2->glyph_cache_hit++;
+      u8g2->glyph_cache_tick++;
+      entry->last_use = u8g2->glyph_cache_tick;
+      return entry;
+    }
+    if ( entry->last_use < lru->last_use )
+      lru = entry;
+  }
+  
+  u8g2->glyph_cache_miss++;
+  glyph_data = u8g2_font_get_glyph_data(u8g2, encoding);
+  if ( glyph_data == NULL )
+    return NULL;
+  
+  u8g2_font_setup_decode(u8g2, glyph_data);
+  h = decode->glyph_height;
+  bitmap_size = (h+7)/8;
+  bitmap_size *= (uint8_t)decode->glyph_width;
+  if ( bitmap_size > u8g2->glyph_cache_bitmap_size )
+    return NULL;
+  
+  lru->font = NULL;
+  lru->glyph_data = glyph_data;
+  lru->encoding = encoding;
+  lru->width = decode->glyph_width;
+  lru->height = h;
+  lru->x = u8g2_font_decode_get_signed_bits(decode, u8g2->font_info.bits_per_char_x);
+  lru->y = u8g2_font_decode_get_signed_bits(decode, u8g2->font_info.bits_per_char_y);
+  lru->delta_x = u8g2_font_decode_get_signed_bits(decode, u8g2->font_info.bits_per_delta_x);
+  
+  bitmap = (uint8_t *)(lru+1);
+  for( i = 0; i < bitmap_size; i++ )
+    bitmap[i] = 0;
+  
+  if ( decode->glyph_width > 0 )
+  {
+    decode->x = 0;
+    decode->y = 0;
+    for(;;)
+    {
+      a = u8g2_font_decode_get_unsigned_bits(decode, u8g2->font_info.bits_per_0);
+      b = u8g2_font_decode_get_unsigned_bits(decode, u8g2->font_info.bits_per_1);
+      do
+      {
+	u8g2_font_bitmap_decode_len(decode, bitmap, a, 0);
+	u8g2_font_bitmap_decode_len(decode, bitmap, b, 1);
+      } while( u8g2_font_decode_get_unsigned_bits(decode, 1) != 0 );
+
+      if ( decode->y >= h )
+	break;
+    }
+  }
+  
+  lru->font = u8g2->font;
+  u8g2->glyph_cache_tick++;
+  lru->last_use = u8g2->glyph_cache_tick;
+  return lru;
+}
+
+/*
+  Description:
+    Copy the bitmap of a cache slot into the tile buffer 
+    (u8g2_ll_hvline_vertical_top_lsb memory layout).
+  Assumptions:
+    decode->target_x/target_y is the upper left corner of the glyph
+    u8g2_font_is_span_draw() returned 1
+*/
+static void u8g2_font_blit_cached_glyph(u8g2_t *u8g2, const u8g2_glyph_cache_entry_t *entry)
+{
+  u8g2_font_decode_t *decode = &(u8g2->font_decode);
+  const uint8_t *bitmap = (const uint8_t *)(entry+1);
+  uint8_t *ptr;
+  uint16_t offset;
+  uint16_t stride;
+  uint16_t y;
+  uint16_t fg, bg;
+  uint8_t fg_or, fg_xor, bg_or, bg_xor;
+  uint8_t color;
+  uint8_t shift;
+  uint8_t rows, r;
+  uint8_t mask;
+  uint8_t x;
+  
+  color = u8g2->draw_color;
+  fg_or = color <= 1 ? 0xff : 0;
+  fg_xor = color != 1 ? 0xff : 0;
+  color = (color == 0 ? 1 : 0);
+  bg_or = 0;
+  bg_xor = 0;
+  if ( decode->is_transparent == 0 )
+  {
+    bg_or = color <= 1 ? 0xff : 0;
+    bg_xor = color != 1 ? 0xff : 0;
+  }
+  
+  y = decode->target_y;
+  y -= u8g2->pixel_curr_row;
+  shift = y & 7;
+  
+  stride = u8g2_GetU8x8(u8g2)->display_info->tile_width;
+  stride *= 8;
+  offset = y >> 3;
+  offset *= stride;
+  offset += decode->target_x;
+  
+  rows = (entry->height + 7) / 8;
+  for( r = 0; r < rows; r++ )
+  {
+    mask = 0xff;
+    if ( r == rows-1 && (entry->height & 7) != 0 )
+      mask = (1 << (entry->height & 7)) - 1;
+    ptr = u8g2->tile_buf_ptr + offset;
+    for( x = 0; x < entry->width; x++ )
+    {
+      fg = *bitmap & mask;
+      bg = ~*bitmap & mask;
+      fg <<= shift;
+      bg <<= shift;
+      ptr[x] |= (fg & fg_or) | (bg & bg_or);
+      ptr[x] ^= (fg & fg_xor) | (bg & bg_xor);
+      if ( (((uint16_t)mask << shift) >> 8) != 0 )
+      {
+	fg >>= 8;
+	bg >>= 8;
+	ptr[x+stride] |= (fg & fg_or) | (bg & bg_or);
+	ptr[x+stride] ^= (fg & fg_xor) | (bg & bg_xor);
+      }
+      bitmap++;
+    }
+    offset += stride;
+  }
+}
+
+/*
+  Description:
+    Draw a glyph from the cache. The glyph is copied into the tile buffer if 
+    possible, otherwise it is decoded from the font data.
+  Return:
+    Width (delta x advance) of the glyph.
+*/
+static int8_t u8g2_font_draw_cached_glyph(u8g2_t *u8g2, const u8g2_glyph_cache_entry_t *entry)
+{
+  u8g2_font_decode_t *decode = &(u8g2->font_decode);
+  u8g2_uint_t x, y;
+  
+  if ( entry->width == 0 )
+    return entry->delta_x;
+  
+  x = decode->target_x;
+  y = decode->target_y;
+  decode->target_x += entry->x;
+  decode->target_y -= entry->height + entry->y;
+  decode->glyph_width = entry->width;
+  if ( u8g2_font_is_span_draw(u8g2, entry->height) )
+  {
+#ifdef U8G2_WITH_DIRTY_TILES
+    u8g2_font_update_dirty_span(u8g2, entry->height);
+#endif /* U8G2_WITH_DIRTY_TILES */
+    u8g2_font_blit_cached_glyph(u8g2, entry);
+    return entry->delta_x;
+  }
+  decode->target_x = x;
+  decode->target_y = y;
+  return u8g2_font_decode_glyph(u8g2, entry->glyph_data);
+}
+
+#endif /* U8G2_WITH_GLYPH_CACHE */
+
 static u8g2_uint_t u8g2_font_draw_glyph(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t y, uint16_t encoding)
 {
   u8g2_uint_t dx = 0;
@@ -667,6 +1327,14 @@ static u8g2_uint_t u8g2_font_draw_glyph(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t
   u8g2->font_decode.target_y = y;
   //u8g2->font_decode.is_transparent = is_transparent; this is already set
   //u8g2->font_decode.dir = dir;
+#ifdef U8G2_WITH_GLYPH_CACHE
+  if ( u8g2->glyph_cache != NULL )
+  {
+    const u8g2_glyph_cache_entry_t *entry = u8g2_font_get_cached_glyph(u8g2, encoding);
+    if ( entry != NULL )
+      return u8g2_font_draw_cached_glyph(u8g2, entry);
+  }
+#endif /* U8G2_WITH_GLYPH_CACHE */
   const uint8_t *glyph_data = u8g2_font_get_glyph_data(u8g2, encoding);
   if ( glyph_data != NULL )
   {
@@ -1014,6 +1682,9 @@ void u8g2_SetFont(u8g2_t *u8g2, const uint8_t  *font)
     u8g2->font = font;
     u8g2_read_font_info(&(u8g2->font_info), font);
     u8g2_UpdateRefHeight(u8g2);
+#ifdef U8G2_WITH_GLYPH_INDEX
+    u8g2_font_build_glyph_index(u8g2);
+#endif /* U8G2_WITH_GLYPH_INDEX */
     /* u8g2_SetFontPosBaseline(u8g2); */ /* removed with issue 195 */
   }
 }
@@ -50,6 +50,38 @@
 
 #include "u8g2.h"
 #include <assert.h>
+#include <string.h>
+
+#ifdef U8G2_WITH_DIRTY_TILES
+/*
+  Mark the tiles of the buffer, which are modified by the line.
+  For u8g2_ll_hvline_vertical_top_lsb, a tile is a 8x8 block of 8 bytes
+*/
+static void u8g2_update_dirty_vertical_top_lsb(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t len, uint8_t dir)
+{
+  uint16_t x1, y1;
+  x1 = x;
+  y1 = y;
+  if ( dir == 0 )
+    x1 += len-1;
+  else
+    y1 += len-1;
+  u8g2_update_dirty_tiles(u8g2, x>>3, (x1>>3)+1, y>>3, (y1>>3)+1);
+}
+
+/*
+  For u8g2_ll_hvline_horizontal_right_lsb, the bytes of a tile are not next 
+  to each other, so the complete tile row is marked.
+*/
+static void u8g2_update_dirty_horizontal_right_lsb(u8g2_t *u8g2, u8g2_uint_t y, u8g2_uint_t len, uint8_t dir)
+{
+  uint16_t y1;
+  y1 = y;
+  if ( dir != 0 )
+    y1 += len-1;
+  u8g2_update_dirty_tiles(u8g2, 0, u8g2_GetU8x8(u8g2)->display_info->tile_width, y>>3, (y1>>3)+1);
+}
+#endif /* U8G2_WITH_DIRTY_TILES */
 
 /*=================================================*/
 /*
@@ -76,6 +108,10 @@ void u8g2_ll_hvline_vertical_top_lsb(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t y,
   uint8_t bit_pos, mask;
   uint8_t or_mask, xor_mask;
 
+#ifdef U8G2_WITH_DIRTY_TILES
+  u8g2_update_dirty_vertical_top_lsb(u8g2, x, y, len, dir);
+#endif /* U8G2_WITH_DIRTY_TILES */
+
   //assert(x >= u8g2->buf_x0);
   //assert(x < u8g2_GetU8x8(u8g2)->display_info->tile_width*8);
   //assert(y >= u8g2->buf_y0);
@@ -191,6 +227,9 @@ static void u8g2_draw_pixel_vertical_top_lsb(u8g2_t *u8g2, u8g2_uint_t x, u8g2_u
 */
 void u8g2_ll_hvline_vertical_top_lsb(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t len, uint8_t dir)
 {
+#ifdef U8G2_WITH_DIRTY_TILES
+  u8g2_update_dirty_vertical_top_lsb(u8g2, x, y, len, dir);
+#endif /* U8G2_WITH_DIRTY_TILES */
   if ( dir == 0 )
   {
     do
@@ -239,6 +278,10 @@ void u8g2_ll_hvline_horizontal_right_lsb(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_
   uint8_t mask;
   uint8_t tile_width = u8g2_GetU8x8(u8g2)->display_info->tile_width;
 
+#ifdef U8G2_WITH_DIRTY_TILES
+  u8g2_update_dirty_horizontal_right_lsb(u8g2, y, len, dir);
+#endif /* U8G2_WITH_DIRTY_TILES */
+
   bit_pos = x;		/* overflow truncate is ok here... */
   bit_pos &= 7; 	/* ... because only the lowest 3 bits are needed */
   mask = 128;
@@ -336,6 +379,9 @@ static void u8g2_draw_pixel_horizontal_right_lsb(u8g2_t *u8g2, u8g2_uint_t x, u8
 */
 void u8g2_ll_hvline_horizontal_right_lsb(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t len, uint8_t dir)
 {
+#ifdef U8G2_WITH_DIRTY_TILES
+  u8g2_update_dirty_horizontal_right_lsb(u8g2, y, len, dir);
+#endif /* U8G2_WITH_DIRTY_TILES */
   if ( dir == 0 )
   {
     do
@@ -357,3 +403,154 @@ void u8g2_ll_hvline_horizontal_right_lsb(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_
 }
 
 #endif /* U8G2_HVLINE_SPEED_OPTIMIZATION */
+
+#ifdef U8G2_WITH_SPAN_FILL
+/*=================================================*/
+/*
+  box fill procedures for the span fill (u8g2_span_fill_box)
+  x,y		Upper left position of the box within the local buffer (not the display!)
+  w,h		width and height of the box in pixel, must not be 0
+  asumption: 
+    all clipping done
+*/
+
+/*
+  u8g2_ll_hvline_vertical_top_lsb: The box is filled tile row by tile row. 
+  Within a tile row, the same bit mask is applied to all bytes of the box.
+*/
+void u8g2_ll_box_vertical_top_lsb(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w, u8g2_uint_t h)
+{
+  uint16_t offset;
+  uint8_t *ptr;
+  uint8_t bit_pos, cnt, mask;
+  uint8_t or_mask, xor_mask;
+  u8g2_uint_t i;
+
+#ifdef U8G2_WITH_DIRTY_TILES
+  {
+    uint16_t x1, y1;
+    x1 = x;
+    x1 += w-1;
+    y1 = y;
+    y1 += h-1;
+    u8g2_update_dirty_tiles(u8g2, x>>3, (x1>>3)+1, y>>3, (y1>>3)+1);
+  }
+#endif /* U8G2_WITH_DIRTY_TILES */
+
+  bit_pos = y;
+  bit_pos &= 7;
+
+  offset = y;
+  offset &= ~7;
+  offset *= u8g2_GetU8x8(u8g2)->display_info->tile_width;
+  ptr = u8g2->tile_buf_ptr;
+  ptr += offset;
+  ptr += x;
+
+  for(;;)
+  {
+    /* number of pixel rows in this tile row */
+    cnt = 8 - bit_pos;
+    if ( h < cnt )
+      cnt = h;
+    mask = 0xff;
+    mask >>= 8 - cnt;
+    mask <<= bit_pos;
+
+    if ( mask == 0xff && u8g2->draw_color <= 1 )
+    {
+      memset(ptr, u8g2->draw_color == 0 ? 0 : 0xff, w);
+    }
+    else
+    {
+      or_mask = 0;
+      xor_mask = 0;
+      if ( u8g2->draw_color <= 1 )
+	or_mask  = mask;
+      if ( u8g2->draw_color != 1 )
+	xor_mask = mask;
+      for( i = 0; i < w; i++ )
+      {
+	ptr[i] |= or_mask;
+	ptr[i] ^= xor_mask;
+      }
+    }
+
+    h -= cnt;
+    if ( h == 0 )
+      break;
+    bit_pos = 0;
+    ptr += u8g2->pixel_buf_width;
+  }
+}
+
+/* apply one byte of a u8g2_ll_hvline_horizontal_right_lsb row */
+static void u8g2_ll_box_byte(uint8_t *ptr, uint8_t mask, uint8_t color)
+{
+  if ( color <= 1 )
+    *ptr |= mask;
+  if ( color != 1 )
+    *ptr ^= mask;
+}
+
+/*
+  u8g2_ll_hvline_horizontal_right_lsb: The masks for the first and the last byte
+  of a pixel row are calculated once, the bytes in between are complete.
+*/
+void u8g2_ll_box_horizontal_right_lsb(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w, u8g2_uint_t h)
+{
+  uint16_t offset;
+  uint8_t *ptr;
+  uint8_t first_mask, last_mask;
+  uint8_t color = u8g2->draw_color;
+  uint8_t tile_width = u8g2_GetU8x8(u8g2)->display_info->tile_width;
+  u8g2_uint_t x1;
+  u8g2_uint_t cnt;	/* number of complete bytes between the first and the last byte */
+  u8g2_uint_t i;
+
+#ifdef U8G2_WITH_DIRTY_TILES
+  u8g2_update_dirty_horizontal_right_lsb(u8g2, y, h, 1);
+#endif /* U8G2_WITH_DIRTY_TILES */
+
+  /* msb is the left pixel */
+  x1 = x;
+  x1 += w-1;
+  first_mask = 0xff >> (x & 7);
+  last_mask = 0xff << (7 - (x1 & 7));
+  cnt = 0;
+  if ( (x1>>3) == (x>>3) )
+  {
+    first_mask &= last_mask;
+    last_mask = 0;
+  }
+  else
+  {
+    cnt = (x1>>3) - (x>>3) - 1;
+  }
+
+  offset = y;
+  offset *= tile_width;
+  offset += x>>3;
+  ptr = u8g2->tile_buf_ptr;
+  ptr += offset;
+
+  do
+  {
+    u8g2_ll_box_byte(ptr, first_mask, color);
+    if ( color <= 1 )
+    {
+      memset(ptr+1, color == 0 ? 0 : 0xff, cnt);
+    }
+    else
+    {
+      for( i = 1; i <= cnt; i++ )
+	ptr[i] ^= 0xff;
+    }
+    if ( last_mask != 0 )
+      u8g2_ll_box_byte(ptr+cnt+1, last_mask, color);
+    ptr += tile_width;
+    h--;
+  } while( h != 0 );
+}
+
+#endif /* U8G2_WITH_SPAN_FILL */
@@ -2,7 +2,22 @@
 
   u8g22_polygon.c
 
-*/	
+  Polygon fill with an active edge table.
+
+  The vertex list is supplied by the caller (u8g2_InitPolygon), there is no
+  static data and no memory allocation. Several polygons can be built and
+  drawn at the same time, e.g. by two tasks with two displays.
+
+  Fill rule:
+    A pixel is set, if the point (x,y) of the pixel is inside the polygon
+    (even-odd rule for self intersecting polygons). Points on a left or
+    upper edge are inside, points on a right or lower edge are outside.
+    As a consequence, two polygons with a common edge never set the same
+    pixel: A fan of triangles (gauge needles, pie charts) is drawn without
+    gaps and without pixels which are drawn twice, so XOR (draw color 2)
+    can be used.
+
+*/
 
 
 #include "u8g2.h"
@@ -15,332 +30,304 @@
 
 typedef int16_t pg_word_t;
 
+/* end of the edge table and the active edge list */
+#define PG_NONE 255
 
-struct pg_point_struct
-{
-  pg_word_t x;
-  pg_word_t y;
-};
-
-typedef struct _pg_struct pg_struct;	/* forward declaration */
-
-struct pg_edge_struct
-{
-  pg_word_t x_direction;	/* 1, if x2 is greater than x1, -1 otherwise */
-  pg_word_t height;
-  pg_word_t current_x_offset;
-  pg_word_t error_offset;
-  
-  /* --- line loop --- */
-  pg_word_t current_y;
-  pg_word_t max_y;
-  pg_word_t current_x;
-  pg_word_t error;
-
-  /* --- outer loop --- */
-  uint8_t (*next_idx_fn)(pg_struct *pg, uint8_t i);
-  uint8_t curr_idx;
-};
-
-/* maximum number of points in the polygon */
-/* can be redefined, but highest possible value is 254 */
+/* vertex list of the old API (u8g2_AddPolygonXY) */
 #define PG_MAX_POINTS 6
 
-/* index numbers for the pge structures below */
-#define PG_LEFT 0
-#define PG_RIGHT 1
-
-
-struct _pg_struct
-{
-  struct pg_point_struct list[PG_MAX_POINTS];
-  uint8_t cnt;
-  uint8_t is_min_y_not_flat;
-  pg_word_t total_scan_line_cnt;
-  struct pg_edge_struct pge[2];	/* left and right line draw structures */
-};
-
 
 /*===========================================*/
-/* procedures, which should not be inlined (save as much flash ROM as possible */
+/* edge procedures */
 
-#define PG_NOINLINE U8G2_NOINLINE
-
-static uint8_t pge_Next(struct pg_edge_struct *pge) PG_NOINLINE;
-static uint8_t pg_inc(pg_struct *pg, uint8_t i) PG_NOINLINE;
-static uint8_t pg_dec(pg_struct *pg, uint8_t i) PG_NOINLINE;
-static void pg_expand_min_y(pg_struct *pg, pg_word_t min_y, uint8_t pge_idx) PG_NOINLINE;
-static void pg_line_init(pg_struct * const pg, uint8_t pge_index) PG_NOINLINE;
-
-/*===========================================*/
-/* line draw algorithm */
-
-static uint8_t pge_Next(struct pg_edge_struct *pge)
+static uint8_t pg_next_idx(u8g2_polygon_t *pg, uint8_t i)
 {
-  if ( pge->current_y >= pge->max_y )
-    return 0;
-  
-  pge->current_x += pge->current_x_offset;
-  pge->error += pge->error_offset;
-  if ( pge->error > 0 )
-  {
-    pge->current_x += pge->x_direction;
-    pge->error -= pge->height;
-  }  
-  
-  pge->current_y++;
-  return 1;
+  i++;
+  if ( i >= pg->cnt )
+    i = 0;
+  return i;
 }
 
-/* assumes y2 > y1 */
-static void pge_Init(struct pg_edge_struct *pge, pg_word_t x1, pg_word_t y1, pg_word_t x2, pg_word_t y2)
+/*
+  Setup the edge from vertex i to the next vertex. The edge data is stored
+  in vertex i. Scanlines above y0 are skipped.
+  Returns 0 if the edge is horizontal or outside of y0 (included) to y1 (excluded).
+*/
+static uint8_t pg_edge_init(u8g2_polygon_t *pg, uint8_t i, pg_word_t y0, pg_word_t y1)
 {
-  pg_word_t dx = x2 - x1;
-  pg_word_t width;
-
-  pge->height = y2 - y1;
-  pge->max_y = y2;
-  pge->current_y = y1;
-  pge->current_x = x1;
-
-  if ( dx >= 0 )
+  u8g2_pg_vertex_t *e = pg->list+i;
+  u8g2_pg_vertex_t *a = e;
+  u8g2_pg_vertex_t *b = pg->list+pg_next_idx(pg, i);
+  u8g2_pg_vertex_t *t;
+  int32_t dx;
+  uint16_t dy;
+  uint16_t skip;
+  uint32_t r;
+
+  if ( a->y == b->y )
+    return 0;
+  if ( a->y > b->y )
   {
-    pge->x_direction = 1;
-    width = dx;
-    pge->error = 0;
+    t = a;
+    a = b;
+    b = t;
   }
-  else
+  if ( b->y <= y0 || a->y >= y1 )
+    return 0;
+
+  /* dx = x_step*dy + err_step with 0 <= err_step < dy */
+  dy = b->y - a->y;
+  dx = b->x - a->x;
+  e->x_step = dx / dy;
+  if ( dx < 0 && (int32_t)e->x_step * dy != dx )
+    e->x_step--;
+  e->err_step = dx - (int32_t)e->x_step * dy;
+  e->dy = dy;
+
+  e->x_curr = a->x;
+  e->err = 0;
+  e->y_top = a->y;
+  e->y_end = b->y;
+
+  if ( a->y < y0 )
   {
-    pge->x_direction = -1;
-    width = -dx;
-    pge->error = 1 - pge->height;
+    /* jump to the first scanline of the clip box */
+    skip = y0 - a->y;
+    r = skip;
+    r *= e->err_step;
+    e->x_curr += (int32_t)skip * e->x_step + (pg_word_t)(r / dy);
+    e->err = r % dy;
+    e->y_top = y0;
   }
-  
-  pge->current_x_offset = dx / pge->height;
-  pge->error_offset = width % pge->height;
-}
-
-/*===========================================*/
-/* convex polygon algorithm */
-
-static uint8_t pg_inc(pg_struct *pg, uint8_t i)
-{
-    i++;
-    if ( i >= pg->cnt )
-      i = 0;
-    return i;
+  return 1;
 }
 
-static uint8_t pg_dec(pg_struct *pg, uint8_t i)
+/* first pixel right of the edge: x_curr + err/dy, rounded up */
+static pg_word_t pg_edge_x(u8g2_pg_vertex_t *e)
 {
-    i--;
-    if ( i >= pg->cnt )
-      i = pg->cnt-1;
-    return i;
+  if ( e->err != 0 )
+    return e->x_curr + 1;
+  return e->x_curr;
 }
 
-static void pg_expand_min_y(pg_struct *pg, pg_word_t min_y, uint8_t pge_idx)
+static void pg_edge_next(u8g2_pg_vertex_t *e)
 {
-  uint8_t i = pg->pge[pge_idx].curr_idx;
-  for(;;)
+  e->x_curr += e->x_step;
+  if ( e->err >= e->dy - e->err_step )
+  {
+    e->err -= e->dy - e->err_step;
+    e->x_curr++;
+  }
+  else
   {
-    i = pg->pge[pge_idx].next_idx_fn(pg, i);
-    if ( pg->list[i].y != min_y )
-      break;	
-    pg->pge[pge_idx].curr_idx = i;
+    e->err += e->err_step;
   }
 }
 
-static uint8_t pg_prepare(pg_struct *pg)
+/* sort the active edge list by x (insertion sort, there are only a few edges) */
+static void pg_sort(u8g2_pg_vertex_t *list, uint8_t *head)
 {
-  pg_word_t max_y;
-  pg_word_t min_y;
+  uint8_t sorted = PG_NONE;
+  uint8_t *pp;
   uint8_t i;
+  pg_word_t x;
 
-  /* setup the next index procedures */
-  pg->pge[PG_RIGHT].next_idx_fn = pg_inc;
-  pg->pge[PG_LEFT].next_idx_fn = pg_dec;
-  
-  /* search for highest and lowest point */
-  max_y = pg->list[0].y;
-  min_y = pg->list[0].y;
-  pg->pge[PG_LEFT].curr_idx = 0;
-  for( i = 1; i < pg->cnt; i++ )
+  while( *head != PG_NONE )
   {
-    if ( max_y < pg->list[i].y )
-    {
-      max_y = pg->list[i].y;
-    }
-    if ( min_y > pg->list[i].y )
-    {
-      pg->pge[PG_LEFT].curr_idx = i;
-      min_y = pg->list[i].y;
-    }
+    i = *head;
+    *head = list[i].next;
+    x = pg_edge_x(list+i);
+    pp = &sorted;
+    while( *pp != PG_NONE && pg_edge_x(list+*pp) < x )
+      pp = &(list[*pp].next);
+    list[i].next = *pp;
+    *pp = i;
   }
+  *head = sorted;
+}
 
-  /* calculate total number of scan lines */
-  pg->total_scan_line_cnt = max_y;
-  pg->total_scan_line_cnt -= min_y;
-  
-  /* exit if polygon height is zero */
-  if ( pg->total_scan_line_cnt == 0 )
-    return 0;
-  
-  /* if the minimum y side is flat, try to find the lowest and highest x points */
-  pg->pge[PG_RIGHT].curr_idx = pg->pge[PG_LEFT].curr_idx;  
-  pg_expand_min_y(pg, min_y, PG_RIGHT);
-  pg_expand_min_y(pg, min_y, PG_LEFT);
-  
-  /* check if the min side is really flat (depends on the x values) */
-  pg->is_min_y_not_flat = 1;
-  if ( pg->list[pg->pge[PG_LEFT].curr_idx].x != pg->list[pg->pge[PG_RIGHT].curr_idx].x )
+/*
+  Draw the pixels from x0 (included) to x1 (excluded).
+  The span must be inside the clip box of the user (user_x0..user_x1, user_y0..user_y1).
+  Without rotation, this is always inside the tile buffer: The span is passed
+  directly to the low level procedure, without the clipping and the rotation
+  of u8g2_DrawHVLine. The low level procedure also updates the dirty tiles.
+*/
+static void pg_hspan(u8g2_t *u8g2, pg_word_t x0, pg_word_t x1, pg_word_t y)
+{
+#ifdef U8G2_WITH_SPAN_FILL
+  if ( u8g2_span_fill_box(u8g2, x0, y, x1 - x0, 1) != 0 )
+    return;
+#endif /* U8G2_WITH_SPAN_FILL */
+  if ( u8g2->cb == &u8g2_cb_r0 )
   {
-    pg->is_min_y_not_flat = 0;
+    y -= u8g2->pixel_curr_row;
+    u8g2->ll_hvline(u8g2, x0, y, x1 - x0, 0);
   }
   else
   {
-    pg->total_scan_line_cnt--;
-    if ( pg->total_scan_line_cnt == 0 )
-      return 0;
+    u8g2_DrawHVLine(u8g2, x0, y, x1 - x0, 0);
   }
+}
 
-  return 1;
+/*===========================================*/
+/* API procedures */
+
+/*
+  list: vertex storage of the caller, max_cnt: number of elements in list (at most 254)
+  The list must exist until the polygon has been drawn.
+*/
+void u8g2_InitPolygon(u8g2_polygon_t *pg, u8g2_pg_vertex_t *list, uint8_t max_cnt)
+{
+  if ( max_cnt >= PG_NONE )
+    max_cnt = PG_NONE-1;
+  pg->list = list;
+  pg->max_cnt = max_cnt;
+  pg->cnt = 0;
 }
 
-static void pg_hline(pg_struct *pg, u8g2_t *u8g2)
+void u8g2_ClearPolygon(u8g2_polygon_t *pg)
 {
-  pg_word_t x1, x2, y;
-  x1 = pg->pge[PG_LEFT].current_x;
-  x2 = pg->pge[PG_RIGHT].current_x;
-  y = pg->pge[PG_RIGHT].current_y;
-  
-  if ( y < 0 )
-    return;
-  if ( y >= u8g2_GetDisplayHeight(u8g2) )  // does not work for 256x64 display???
-    return;
-  if ( x1 < x2 )
-  {
-    if ( x2 < 0 )
-      return;
-    if ( x1 >= u8g2_GetDisplayWidth(u8g2) )
-      return;
-    if ( x1 < 0 )
-      x1 = 0;
-    if ( x2 >= u8g2_GetDisplayWidth(u8g2) )
-      x2 = u8g2_GetDisplayWidth(u8g2);
-    u8g2_DrawHLine(u8g2, x1, y, x2 - x1);
-  }
-  else
-  {
-    if ( x1 < 0 )
-      return;
-    if ( x2 >= u8g2_GetDisplayWidth(u8g2) )
-      return;
-    if ( x2 < 0 )
-      x1 = 0;
-    if ( x1 >= u8g2_GetDisplayWidth(u8g2) )
-      x1 = u8g2_GetDisplayWidth(u8g2);
-    u8g2_DrawHLine(u8g2, x2, y, x1 - x2);
-  }
+  pg->cnt = 0;
 }
 
-static void pg_line_init(pg_struct * const pg, uint8_t pge_index)
+/* returns 0 if the vertex list is full */
+uint8_t u8g2_AddPolygonVertex(u8g2_polygon_t *pg, int16_t x, int16_t y)
 {
-  struct pg_edge_struct  *pge = pg->pge+pge_index;
-  uint8_t idx;  
-  pg_word_t x1;
-  pg_word_t y1;
-  pg_word_t x2;
-  pg_word_t y2;
-
-  idx = pge->curr_idx;  
-  y1 = pg->list[idx].y;
-  x1 = pg->list[idx].x;
-  idx = pge->next_idx_fn(pg, idx);
-  y2 = pg->list[idx].y;
-  x2 = pg->list[idx].x; 
-  pge->curr_idx = idx;
-  
-  pge_Init(pge, x1, y1, x2, y2);
+  if ( pg->cnt >= pg->max_cnt )
+    return 0;
+  pg->list[pg->cnt].x = x;
+  pg->list[pg->cnt].y = y;
+  pg->cnt++;
+  return 1;
 }
 
-static void pg_exec(pg_struct *pg, u8g2_t *u8g2)
+/*
+  Fill the polygon with the current draw color. The polygon may be concave
+  or self intersecting. The difference of two x or two y values must fit into int16_t.
+*/
+void u8g2_FillPolygon(u8g2_t *u8g2, u8g2_polygon_t *pg)
 {
-  pg_word_t i = pg->total_scan_line_cnt;
+  u8g2_pg_vertex_t *list = pg->list;
+  u8g2_pg_vertex_t *e;
+  pg_word_t x0, x1, y0, y1;
+  pg_word_t y, xa, xb;
+  uint8_t et, aet;
+  uint8_t *pp;
+  uint8_t i, j;
+
+  if ( pg->cnt < 3 )
+    return;
+
+  x0 = u8g2->user_x0;
+  x1 = u8g2->user_x1;
+  y0 = u8g2->user_y0;
+  y1 = u8g2->user_y1;
 
-  /* first line is skipped if the min y line is not flat */
-  pg_line_init(pg, PG_LEFT);		
-  pg_line_init(pg, PG_RIGHT);
-  
-  if ( pg->is_min_y_not_flat != 0 )
+  /* edge table: the edges which intersect the clip box, sorted by y_top */
+  et = PG_NONE;
+  for( i = 0; i < pg->cnt; i++ )
   {
-    pge_Next(&(pg->pge[PG_LEFT])); 
-    pge_Next(&(pg->pge[PG_RIGHT]));
+    if ( pg_edge_init(pg, i, y0, y1) != 0 )
+    {
+      pp = &et;
+      while( *pp != PG_NONE && list[*pp].y_top <= list[i].y_top )
+	pp = &(list[*pp].next);
+      list[i].next = *pp;
+      *pp = i;
+    }
   }
 
-  do
+  aet = PG_NONE;
+  y = y0;
+  for(;;)
   {
-    pg_hline(pg, u8g2);
-    while ( pge_Next(&(pg->pge[PG_LEFT])) == 0 )
+    if ( aet == PG_NONE )
     {
-      pg_line_init(pg, PG_LEFT);
+      /* skip empty scanlines */
+      if ( et == PG_NONE )
+	break;
+      y = list[et].y_top;
     }
-    while ( pge_Next(&(pg->pge[PG_RIGHT])) == 0 )
+    if ( y >= y1 )
+      break;
+
+    /* move the edges which start at this scanline to the active edge list */
+    while( et != PG_NONE && list[et].y_top == y )
     {
-      pg_line_init(pg, PG_RIGHT);
+      i = et;
+      et = list[i].next;
+      list[i].next = aet;
+      aet = i;
     }
-    i--;
-  } while( i > 0 );
-}
+    pg_sort(list, &aet);
 
-/*===========================================*/
-/* API procedures */
-
-void pg_ClearPolygonXY(pg_struct *pg)
-{
-  pg->cnt = 0;
-}
+    /* draw the spans between the 1st and 2nd, 3rd and 4th ... edge */
+    i = aet;
+    while( i != PG_NONE )
+    {
+      j = list[i].next;
+      if ( j == PG_NONE )
+	break;
+      xa = pg_edge_x(list+i);
+      xb = pg_edge_x(list+j);
+      if ( xa < x0 )
+	xa = x0;
+      if ( xb > x1 )
+	xb = x1;
+      if ( xa < xb )
+	pg_hspan(u8g2, xa, xb, y);
+      i = list[j].next;
+    }
 
-void pg_AddPolygonXY(pg_struct *pg, int16_t x, int16_t y)
-{
-  if ( pg->cnt < PG_MAX_POINTS )
-  {
-    pg->list[pg->cnt].x = x;
-    pg->list[pg->cnt].y = y;
-    pg->cnt++;
+    /* next scanline: remove the finished edges, advance the others */
+    y++;
+    pp = &aet;
+    while( *pp != PG_NONE )
+    {
+      e = list+*pp;
+      if ( y >= e->y_end )
+      {
+	*pp = e->next;
+      }
+      else
+      {
+	pg_edge_next(e);
+	pp = &(e->next);
+      }
+    }
   }
 }
 
-void pg_DrawPolygon(pg_struct *pg, u8g2_t *u8g2)
-{
-  if ( pg_prepare(pg) == 0 )
-    return;
-  pg_exec(pg, u8g2);
-}
+/*===========================================*/
+/* old API, uses a static vertex list */
 
-pg_struct u8g2_pg;
+static u8g2_pg_vertex_t u8g2_pg_list[PG_MAX_POINTS];
+static u8g2_polygon_t u8g2_pg = { u8g2_pg_list, PG_MAX_POINTS, 0 };
 
 void u8g2_ClearPolygonXY(void)
 {
-  pg_ClearPolygonXY(&u8g2_pg);
+  u8g2_ClearPolygon(&u8g2_pg);
 }
 
 void u8g2_AddPolygonXY(U8X8_UNUSED u8g2_t *u8g2, int16_t x, int16_t y)
 {
-  pg_AddPolygonXY(&u8g2_pg, x, y);
+  u8g2_AddPolygonVertex(&u8g2_pg, x, y);
 }
 
 void u8g2_DrawPolygon(u8g2_t *u8g2)
 {
-  pg_DrawPolygon(&u8g2_pg, u8g2);
+  u8g2_FillPolygon(u8g2, &u8g2_pg);
 }
 
 void u8g2_DrawTriangle(u8g2_t *u8g2, int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2)
 {
-  u8g2_ClearPolygonXY();
-  u8g2_AddPolygonXY(u8g2, x0, y0);
-  u8g2_AddPolygonXY(u8g2, x1, y1);
-  u8g2_AddPolygonXY(u8g2, x2, y2);
-  u8g2_DrawPolygon(u8g2);
+  u8g2_pg_vertex_t list[3];
+  u8g2_polygon_t pg;
+
+  u8g2_InitPolygon(&pg, list, 3);
+  u8g2_AddPolygonVertex(&pg, x0, y0);
+  u8g2_AddPolygonVertex(&pg, x1, y1);
+  u8g2_AddPolygonVertex(&pg, x2, y2);
+  u8g2_FillPolygon(u8g2, &pg);
 }
-
@@ -62,6 +62,24 @@ void u8g2_SetupBuffer(u8g2_t *u8g2, uint8_t *buf, uint8_t tile_buf_height, u8g2_
 
   u8g2_SetFontPosBaseline(u8g2);  /* issue 195 */
   
+#ifdef U8G2_WITH_GLYPH_INDEX
+  u8g2->glyph_index_buf = NULL;
+  u8g2->glyph_index_size = 0;
+  u8g2->glyph_index_ascii = NULL;
+  u8g2->glyph_index_unicode_cnt = 0;
+#endif /* U8G2_WITH_GLYPH_INDEX */
+
+#ifdef U8G2_WITH_GLYPH_CACHE
+  u8g2->glyph_cache = NULL;
+  u8g2->glyph_cache_cnt = 0;
+#endif /* U8G2_WITH_GLYPH_CACHE */
+
+#ifdef U8G2_WITH_DIRTY_TILES
+  /* display content is unknown: the first u8g2_UpdateDisplay() will send all tiles */
+  memset(u8g2->dirty_x0, 0, U8G2_DIRTY_TILE_ROWS);
+  memset(u8g2->dirty_x1, 255, U8G2_DIRTY_TILE_ROWS);
+#endif /* U8G2_WITH_DIRTY_TILES */
+  
 #ifdef U8G2_WITH_FONT_ROTATION  
   u8g2->font_decode.dir = 0;
 #endif
@@ -104,6 +104,14 @@
 /* 26 May 2016: Obsolete */
 //#define U8X8_DEFAULT_FLIP_MODE 0
 
+/* Max. number of data bytes within one I2C transfer of u8x8_cad_ssd13xx_i2c() */
+/* The default (24) is required for the Arduino Wire library. Byte procedures */
+/* without such a limit can use a larger value, see component.mk of the ESP32 */
+/* project. Must not be larger than 255. */
+#ifndef U8X8_I2C_DATA_CHUNK_SIZE
+#define U8X8_I2C_DATA_CHUNK_SIZE 24
+#endif
+
 /*==========================================*/
 /* Includes */
 
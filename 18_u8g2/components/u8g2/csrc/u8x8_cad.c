@@ -432,12 +432,13 @@ uint8_t u8x8_cad_ssd13xx_i2c(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *a
       /* Unfortunately, this can not be handled in the byte level drivers, */
       /* so this is done here. Even further, only 24 bytes will be sent, */
       /* because there will be another byte (DC) required during the transfer */
+      /* The chunk size can be changed with U8X8_I2C_DATA_CHUNK_SIZE. */
       p = arg_ptr;
-       while( arg_int > 24 )
+       while( arg_int > U8X8_I2C_DATA_CHUNK_SIZE )
       {
-	u8x8_i2c_data_transfer(u8x8, 24, p);
-	arg_int-=24;
-	p+=24;
+	u8x8_i2c_data_transfer(u8x8, U8X8_I2C_DATA_CHUNK_SIZE, p);
+	arg_int-=U8X8_I2C_DATA_CHUNK_SIZE;
+	p+=U8X8_I2C_DATA_CHUNK_SIZE;
       }
       u8x8_i2c_data_transfer(u8x8, arg_int, p);
       break;
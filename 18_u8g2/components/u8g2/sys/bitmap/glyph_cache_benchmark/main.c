@@ -0,0 +1,82 @@
+#include "u8g2.h"
+#include <stdio.h>
+#include <time.h>
+
+/* the fonts are not part of csrc/u8g2_fonts.c in this tree, use the single font files */
+#include "../../../tools/font/build/single_font_files/u8g2_font_helvR08_tr.c"
+#include "../../../tools/font/build/single_font_files/u8g2_font_ncenB14_tr.c"
+
+/*
+ * Compares text drawing with and without the glyph cache (U8G2_WITH_GLYPH_CACHE).
+ * The screen is a typical status display: a few labels and numbers, which are
+ * redrawn for every frame. The last frame of each run is written to a TGA file.
+ */
+
+#define FRAMES 5000
+
+u8g2_t u8g2;
+uint32_t glyph_cache[1024];	/* 4 KB */
+
+static double get_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void draw_frame(uint32_t frame)
+{
+  u8g2_ClearBuffer(&u8g2);
+  u8g2_SetFont(&u8g2, u8g2_font_ncenB14_tr);
+  u8g2_DrawStr(&u8g2, 0, 16, u8x8_u16toa(frame % 10000, 4));
+  u8g2_DrawStr(&u8g2, 60, 16, "kWh");
+  u8g2_SetFont(&u8g2, u8g2_font_helvR08_tr);
+  u8g2_DrawStr(&u8g2, 0, 30, "Temp:");
+  u8g2_DrawStr(&u8g2, 40, 30, u8x8_u8toa(frame % 100, 2));
+  u8g2_DrawStr(&u8g2, 56, 30, "C");
+  u8g2_DrawStr(&u8g2, 0, 42, "Humidity:");
+  u8g2_DrawStr(&u8g2, 60, 42, u8x8_u8toa((frame/7) % 100, 2));
+  u8g2_DrawStr(&u8g2, 76, 42, "%");
+  u8g2_SetDrawColor(&u8g2, 1);
+  u8g2_DrawBox(&u8g2, 0, 50, 128, 14);
+  u8g2_SetDrawColor(&u8g2, 0);
+  u8g2_DrawStr(&u8g2, 2, 61, "WiFi OK  MQTT OK  12:34");
+  u8g2_SetDrawColor(&u8g2, 1);
+}
+
+static double run(const char *tga)
+{
+  uint32_t i;
+  double t;
+  
+  t = get_ns();
+  for( i = 0; i < FRAMES; i++ )
+    draw_frame(i);
+  t = get_ns() - t;
+  u8g2_SendBuffer(&u8g2);
+  u8x8_SaveBitmapTGA(u8g2_GetU8x8(&u8g2), tga);
+  return t / FRAMES;
+}
+
+int main(void)
+{
+  double t;
+  
+  u8g2_SetupBitmap(&u8g2, &u8g2_cb_r0, 128, 64);
+  u8x8_InitDisplay(u8g2_GetU8x8(&u8g2));
+  u8x8_SetPowerSave(u8g2_GetU8x8(&u8g2), 0);
+  u8g2_SetFontMode(&u8g2, 1);
+
+  printf("without cache: %8.0f ns/frame\n", run("no_cache.tga"));
+  
+  /* 64 byte bitmaps: enough for glyphs up to 32x16 pixel */
+  u8g2_SetGlyphCache(&u8g2, glyph_cache, sizeof(glyph_cache), 64);
+  t = run("cache.tga");
+  printf("with cache:    %8.0f ns/frame (%u slots, %lu hits, %lu misses)\n", 
+    t, 
+    u8g2.glyph_cache_cnt,
+    (unsigned long)u8g2_GetGlyphCacheHits(&u8g2), 
+    (unsigned long)u8g2_GetGlyphCacheMisses(&u8g2));
+
+  return 0;
+}
@@ -0,0 +1,212 @@
+#include "u8g2.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* the fonts are not part of csrc/u8g2_fonts.c in this tree, use the single font files */
+#include "../../../tools/font/build/single_font_files/u8g2_font_6x10_tf.c"
+#include "../../../tools/font/build/single_font_files/u8g2_font_helvB10_tr.c"
+#include "../../../tools/font/build/single_font_files/u8g2_font_unifont_t_chinese2.c"
+
+/*
+ * Render benchmark: draws a fixed set of scenes on a 128x64 bitmap display
+ * in full buffer and page buffer mode and reports for each scene
+ *   ns/frame	time for one frame (picture loop including the transfer to the bitmap)
+ *   glyphs	calls to u8g2_font_get_glyph_data() per frame
+ *   hvlines	calls to u8g2_draw_hv_line_4dir() per frame
+ *
+ * Usage: render_benchmark [frames] [-tga]
+ *   -tga writes the last full buffer frame of each scene to <scene>.tga, 
+ *   which can be compared with the output of a previous version.
+ *
+ * The counters require U8G2_WITH_HVLINE_COUNT and U8G2_WITH_GLYPH_LOOKUP_COUNT,
+ * both are defined in the Makefile.
+ */
+
+#define WIDTH 128
+#define HEIGHT 64
+
+u8g2_t u8g2;
+uint8_t page_buf[WIDTH*2];	/* 2 tile rows */
+uint8_t xbm[40*40/8];
+
+/*========================================================*/
+/* scenes */
+
+static void scene_text(uint32_t frame)
+{
+  u8g2_uint_t y;
+  u8g2_SetFont(&u8g2, u8g2_font_6x10_tf);
+  for( y = 10; y <= HEIGHT; y += 10 )
+    u8g2_DrawStr(&u8g2, 0, y, "The quick brown fox jumps");
+  u8g2_SetFont(&u8g2, u8g2_font_helvB10_tr);
+  u8g2_DrawStr(&u8g2, 80, 12, u8x8_u16toa(frame % 10000, 4));
+}
+
+static void scene_cjk(uint32_t frame)
+{
+  u8g2_SetFont(&u8g2, u8g2_font_unifont_t_chinese2);
+  u8g2_DrawUTF8(&u8g2, 0, 15, "你好世界，欢迎光临");
+  u8g2_DrawUTF8(&u8g2, 0, 31, "温度湿度电压电流");
+  u8g2_DrawUTF8(&u8g2, 0, 47, "设置菜单返回确定");
+  u8g2_DrawUTF8(&u8g2, 0, 63, frame & 1 ? "网络已连接" : "网络未连接");
+}
+
+static void scene_circles(uint32_t frame)
+{
+  u8g2_uint_t r;
+  for( r = 2; r < 32; r += 3 )
+    u8g2_DrawCircle(&u8g2, 32, 32, r, U8G2_DRAW_ALL);
+  u8g2_DrawDisc(&u8g2, 96, 32, 28, U8G2_DRAW_ALL);
+  u8g2_SetDrawColor(&u8g2, 0);
+  u8g2_DrawDisc(&u8g2, 96, 32, 4 + frame % 20, U8G2_DRAW_ALL);
+  u8g2_SetDrawColor(&u8g2, 1);
+  u8g2_DrawFilledEllipse(&u8g2, 64, 56, 20, 6, U8G2_DRAW_ALL);
+}
+
+static void scene_polygons(uint32_t frame)
+{
+  u8g2_uint_t i;
+  for( i = 0; i < 8; i++ )
+    u8g2_DrawTriangle(&u8g2, i*16, 0, i*16+15, (frame+i*7) % 64, i*16+4, 63);
+  u8g2_SetDrawColor(&u8g2, 2);
+  u8g2_ClearPolygonXY();
+  u8g2_AddPolygonXY(&u8g2, 10, 10);
+  u8g2_AddPolygonXY(&u8g2, 118, 20);
+  u8g2_AddPolygonXY(&u8g2, 90, 60);
+  u8g2_AddPolygonXY(&u8g2, 64, 40);
+  u8g2_AddPolygonXY(&u8g2, 20, 58);
+  u8g2_DrawPolygon(&u8g2);
+  u8g2_SetDrawColor(&u8g2, 1);
+}
+
+static void scene_xbm(uint32_t frame)
+{
+  u8g2_uint_t x, y;
+  for( y = 0; y < HEIGHT; y += 40 )
+    for( x = 0; x < WIDTH; x += 40 )
+      u8g2_DrawXBM(&u8g2, x + frame % 8, y, 40, 40, xbm);
+}
+
+static void scene_boxes(uint32_t frame)
+{
+  u8g2_uint_t i;
+  for( i = 0; i < 6; i++ )
+  {
+    u8g2_DrawFrame(&u8g2, i*4, i*4, WIDTH-i*8, HEIGHT-i*8);
+    u8g2_DrawRBox(&u8g2, 30 + i*14, 26, 12, 12 + (frame+i) % 8, 3);
+  }
+  u8g2_DrawLine(&u8g2, 0, 0, WIDTH-1, HEIGHT-1);
+  u8g2_DrawLine(&u8g2, 0, HEIGHT-1, WIDTH-1, 0);
+}
+
+struct scene
+{
+  const char *name;
+  void (*draw)(uint32_t frame);
+};
+
+static const struct scene scenes[] =
+{
+  { "text", scene_text },
+  { "cjk", scene_cjk },
+  { "circles", scene_circles },
+  { "polygons", scene_polygons },
+  { "xbm", scene_xbm },
+  { "boxes", scene_boxes },
+};
+
+/*========================================================*/
+/* buffer modes */
+
+#define MODE_FULL 0
+#define MODE_PAGE_1 1
+#define MODE_PAGE_2 2
+
+static const char *mode_names[] = { "full", "page 1", "page 2" };
+
+static void setup(uint8_t mode)
+{
+  u8g2_SetupBitmap(&u8g2, U8G2_R0, WIDTH, HEIGHT);
+  if ( mode != MODE_FULL )
+    u8g2_SetupBuffer(&u8g2, page_buf, mode, u8g2_ll_hvline_vertical_top_lsb, U8G2_R0);
+  u8g2_InitDisplay(&u8g2);
+  u8g2_SetPowerSave(&u8g2, 0);
+}
+
+static void draw_frame(const struct scene *s, uint8_t mode, uint32_t frame)
+{
+  if ( mode == MODE_FULL )
+  {
+    u8g2_ClearBuffer(&u8g2);
+    s->draw(frame);
+    u8g2_SendBuffer(&u8g2);
+  }
+  else
+  {
+    u8g2_FirstPage(&u8g2);
+    do
+    {
+      s->draw(frame);
+    } while( u8g2_NextPage(&u8g2) );
+  }
+}
+
+static double get_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*========================================================*/
+
+int main(int argc, char **argv)
+{
+  uint32_t frames = 2000;
+  int is_tga = 0;
+  uint32_t i;
+  unsigned s;
+  uint8_t mode;
+  double t;
+  char name[32];
+  
+  for( i = 1; i < (uint32_t)argc; i++ )
+  {
+    if ( strcmp(argv[i], "-tga") == 0 )
+      is_tga = 1;
+    else
+      frames = atoi(argv[i]);
+  }
+  if ( frames == 0 )
+    frames = 1;
+  
+  /* checkerboard pattern */
+  for( i = 0; i < sizeof(xbm); i++ )
+    xbm[i] = ((i / 5) & 4) ? 0xaa : 0x55;
+  
+  printf("%-10s %-7s %12s %10s %10s\n", "scene", "mode", "ns/frame", "glyphs", "hvlines");
+  for( s = 0; s < sizeof(scenes)/sizeof(*scenes); s++ )
+  {
+    for( mode = MODE_FULL; mode <= MODE_PAGE_2; mode++ )
+    {
+      setup(mode);
+      draw_frame(scenes+s, mode, 0);	/* warm up */
+      u8g2.hv_cnt = 0;
+      u8g2.glyph_lookup_cnt = 0;
+      t = get_ns();
+      for( i = 0; i < frames; i++ )
+	draw_frame(scenes+s, mode, i);
+      t = get_ns() - t;
+      printf("%-10s %-7s %12.0f %10lu %10lu\n", scenes[s].name, mode_names[mode], 
+	t / frames, u8g2.glyph_lookup_cnt / frames, u8g2.hv_cnt / frames);
+      if ( is_tga && mode == MODE_FULL )
+      {
+	snprintf(name, sizeof(name), "%s.tga", scenes[s].name);
+	u8x8_SaveBitmapTGA(u8g2_GetU8x8(&u8g2), name);
+      }
+    }
+  }
+  return 0;
+}
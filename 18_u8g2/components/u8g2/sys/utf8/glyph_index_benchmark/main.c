@@ -0,0 +1,131 @@
+/*
+  glyph_index_benchmark
+
+  Compares the glyph lookup of u8g2_font_get_glyph_data() with and without
+  the glyph index (U8G2_WITH_GLYPH_INDEX, u8g2_SetGlyphIndexBuffer).
+  
+  All glyphs of the font are searched in a pseudo random order, so that the
+  "last_font_data" shortcut for __unix__ systems has no advantage.
+  The second test draws UTF-8 strings into the utf8 frame buffer.
+*/
+
+#include "u8g2.h"
+#include <stdio.h>
+#include <time.h>
+
+/* the font is not part of csrc/u8g2_fonts.c in this tree, use the single font file */
+#include "../../../tools/font/build/single_font_files/u8g2_font_unifont_t_chinese2.c"
+
+#define ROUNDS 200
+
+u8g2_t u8g2;
+
+uint16_t encoding_list[0x10000];
+uint32_t glyph_index_buf[8192];	/* 32 KB: 512 bytes for 0..255, remaining for unicode glyphs */
+
+/* simple linear congruential generator, same sequence on all systems */
+static uint32_t rnd_state = 1;
+static uint32_t rnd(void)
+{
+  rnd_state = rnd_state * 1103515245UL + 12345UL;
+  return (rnd_state >> 16) & 0x7fff;
+}
+
+static double get_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void set_index(void *buf, size_t size)
+{
+  u8g2_SetGlyphIndexBuffer(&u8g2, buf, size);
+#ifdef  __unix__
+  u8g2.last_font_data = NULL;
+  u8g2.last_unicode = 0x0ffff;
+#endif 
+}
+
+static double lookup_test(uint32_t cnt)
+{
+  uint32_t i, r;
+  uint32_t found = 0;
+  double t;
+  
+  t = get_ns();
+  for( r = 0; r < ROUNDS; r++ )
+    for( i = 0; i < cnt; i++ )
+      found += u8g2_IsGlyph(&u8g2, encoding_list[i]);
+  t = get_ns() - t;
+  
+  if ( found != cnt*ROUNDS )
+    printf("error: %u of %u glyphs found\n", found, cnt*ROUNDS);
+  return t / ((double)cnt*ROUNDS);
+}
+
+static double draw_test(void)
+{
+  uint32_t r;
+  double t;
+  
+  t = get_ns();
+  for( r = 0; r < ROUNDS; r++ )
+  {
+    u8g2_FirstPage(&u8g2);
+    do
+    {      
+      u8g2_DrawUTF8(&u8g2, 0, 15, "你好世界你好世界");
+      u8g2_DrawUTF8(&u8g2, 0, 31, "世界你好世界你好");
+    } while( u8g2_NextPage(&u8g2) );
+  }
+  t = get_ns() - t;
+  return t / ROUNDS;
+}
+
+int main(void)
+{
+  uint32_t e, i, j, cnt;
+  uint16_t tmp;
+
+  u8g2_SetupBuffer_Utf8(&u8g2, &u8g2_cb_r0);
+  u8x8_InitDisplay(u8g2_GetU8x8(&u8g2));
+  u8x8_SetPowerSave(u8g2_GetU8x8(&u8g2), 0);  
+  
+  u8g2_SetFont(&u8g2, u8g2_font_unifont_t_chinese2);
+  u8g2_SetFontDirection(&u8g2, 0);
+  
+  /* use the index to collect all glyphs of the font */
+  set_index(glyph_index_buf, sizeof(glyph_index_buf));
+  cnt = 0;
+  for( e = 1; e < 0x0ffff; e++ )
+    if ( u8g2_IsGlyph(&u8g2, e) )
+      encoding_list[cnt++] = e;
+  
+  /* shuffle */
+  for( i = cnt-1; i > 0; i-- )
+  {
+    j = rnd() % (i+1);
+    tmp = encoding_list[i];
+    encoding_list[i] = encoding_list[j];
+    encoding_list[j] = tmp;
+  }
+  
+  printf("font: u8g2_font_unifont_t_chinese2, %u glyphs\n", cnt);
+  
+  set_index(NULL, 0);
+  printf("lookup, linear search:           %8.1f ns/glyph\n", lookup_test(cnt));
+  set_index(glyph_index_buf, sizeof(glyph_index_buf));
+  printf("lookup, full index (%2u step):    %8.1f ns/glyph\n", u8g2.glyph_index_step, lookup_test(cnt));
+  set_index(glyph_index_buf, 512+64*sizeof(u8g2_glyph_index_entry_t));
+  printf("lookup, 64 entry index (%2u step):%8.1f ns/glyph\n", u8g2.glyph_index_step, lookup_test(cnt));
+  
+  set_index(NULL, 0);
+  printf("draw, linear search:             %8.1f ns/frame\n", draw_test());
+  set_index(glyph_index_buf, sizeof(glyph_index_buf));
+  printf("draw, full index:                %8.1f ns/frame\n", draw_test());
+  
+  utf8_show();
+  
+  return 0;
+}
@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "u8g2_esp32_flush.h"
+
+static const char *TAG = "u8g2_flush";
+
+static u8g2_t            *flush_u8g2;       // u8g2 structure of the display
+static uint8_t           *flush_buf;        // buffer, which is not used by the application
+static SemaphoreHandle_t  flush_ready;      // given by the app: flush_buf contains a new frame
+static SemaphoreHandle_t  flush_done;       // given by the flush task: flush_buf has been sent
+static TickType_t         flush_period;     // min. ticks between two frames, 0: no frame pacing
+static TickType_t         flush_last_wake;  // time of the last swap
+
+/*
+ * Flush task: send each frame, which is handed over by u8g2_esp32_flush_swap().
+ */
+static void u8g2_esp32_flush_task(void *pvParameter) {
+	while(1) {
+		xSemaphoreTake(flush_ready, portMAX_DELAY);
+		u8g2_SendTileBuffer(flush_u8g2, flush_buf);
+		xSemaphoreGive(flush_done);
+	}
+} // u8g2_esp32_flush_task
+
+/*
+ * Allocate the second buffer and start the flush task on the other core.
+ * Call this after u8g2_InitDisplay() and u8g2_SetPowerSave(). Only full
+ * buffer setups (u8g2_Setup_..._f) are supported.
+ * frame_period_ms: min. time between two frames, 0 disables frame pacing.
+ */
+esp_err_t u8g2_esp32_flush_init(u8g2_t *u8g2, uint32_t frame_period_ms) {
+	BaseType_t core;
+
+	if (u8g2_GetBufferTileHeight(u8g2) < u8g2_GetU8x8(u8g2)->display_info->tile_height) {
+		ESP_LOGE(TAG, "double buffering requires the full buffer mode");
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	flush_u8g2 = u8g2;
+	flush_period = frame_period_ms / portTICK_PERIOD_MS;
+	flush_last_wake = xTaskGetTickCount();
+	flush_buf = heap_caps_malloc(u8g2_GetBufferSize(u8g2), MALLOC_CAP_8BIT);
+	flush_ready = xSemaphoreCreateBinary();
+	flush_done = xSemaphoreCreateBinary();
+	if (flush_buf == NULL || flush_ready == NULL || flush_done == NULL) {
+		ESP_LOGE(TAG, "out of memory");
+		return ESP_ERR_NO_MEM;
+	}
+	memset(flush_buf, 0, u8g2_GetBufferSize(u8g2));
+
+	// flush_buf is not in use
+	xSemaphoreGive(flush_done);
+
+	core = (xPortGetCoreID() == 0) ? 1 : 0;
+	if (xTaskCreatePinnedToCore(&u8g2_esp32_flush_task, "u8g2_flush", U8G2_FLUSH_TASK_STACK, NULL, U8G2_FLUSH_TASK_PRIORITY, NULL, core) != pdPASS) {
+		ESP_LOGE(TAG, "unable to create the flush task");
+		return ESP_ERR_NO_MEM;
+	}
+	ESP_LOGI(TAG, "flush task started on core %d", core);
+	return ESP_OK;
+} // u8g2_esp32_flush_init
+
+/*
+ * Hand over the current frame to the flush task and continue with the other
+ * buffer, which gets a copy of the frame. Replaces u8g2_SendBuffer().
+ * Waits until the previous frame has been sent and, with frame pacing, until
+ * frame_period_ms have elapsed since the last swap.
+ */
+void u8g2_esp32_flush_swap(u8g2_t *u8g2) {
+	xSemaphoreTake(flush_done, portMAX_DELAY);
+	if (flush_period > 0) {
+		vTaskDelayUntil(&flush_last_wake, flush_period);
+	}
+	flush_buf = u8g2_SwapBuffer(u8g2, flush_buf);
+	xSemaphoreGive(flush_ready);
+} // u8g2_esp32_flush_swap
+
+/*
+ * Wait until the last frame has been sent. Call this before other u8g2
+ * functions, which talk to the display (e.g. u8g2_SetPowerSave()).
+ */
+void u8g2_esp32_flush_wait(void) {
+	xSemaphoreTake(flush_done, portMAX_DELAY);
+	xSemaphoreGive(flush_done);
+} // u8g2_esp32_flush_wait
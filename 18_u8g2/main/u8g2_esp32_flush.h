@@ -0,0 +1,20 @@
+/*
+ * u8g2_esp32_flush.h
+ *
+ * Double buffered full buffer mode: the application draws into the back
+ * buffer while a flush task on the other core sends the front buffer.
+ */
+
+#ifndef U8G2_ESP32_FLUSH_H_
+#define U8G2_ESP32_FLUSH_H_
+#include "u8g2.h"
+
+#include "esp_err.h"
+
+#define U8G2_FLUSH_TASK_STACK       2048   //  stack size of the flush task
+#define U8G2_FLUSH_TASK_PRIORITY    5      //  priority of the flush task
+
+esp_err_t u8g2_esp32_flush_init(u8g2_t *u8g2, uint32_t frame_period_ms);
+void u8g2_esp32_flush_swap(u8g2_t *u8g2);
+void u8g2_esp32_flush_wait(void);
+#endif /* U8G2_ESP32_FLUSH_H_ */
@@ -6,6 +6,7 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "esp_heap_caps.h"
 
 #include "u8g2_esp32_hal.h"
 
@@ -16,9 +17,68 @@ static spi_device_handle_t handle_spi;      // SPI handle.
 static i2c_cmd_handle_t    handle_i2c;      // I2C handle.
 static u8g2_esp32_hal_t    u8g2_esp32_hal;  // HAL state data.
 
+static uint8_t  i2c_buf[I2C_BUF_SIZE];      // bytes of the current I2C transfer
+static uint16_t i2c_len;                    // number of bytes in i2c_buf
+static uint16_t i2c_queued;                 // bytes of i2c_buf, which are already in handle_i2c
+
 #undef ESP_ERROR_CHECK
 #define ESP_ERROR_CHECK(x)   do { esp_err_t rc = (x); if (rc != ESP_OK) { ESP_LOGE("err", "esp_err_t = %d", rc); assert(0 && #x);} } while(0);
 
+#if SPI_QUEUED_TRANSFER
+/*
+ * Queued SPI transfer: the bytes of consecutive U8X8_MSG_BYTE_SEND messages are
+ * copied into a ring of DMA capable buffers. A buffer is queued with
+ * spi_device_queue_trans when it is full, when the DC level changes or at the
+ * end of a transfer. The caller only waits if all buffers are in flight.
+ */
+static spi_transaction_t spi_trans[SPI_QUEUE_SIZE]; // transaction descriptors
+static uint8_t *spi_buf[SPI_QUEUE_SIZE];             // DMA capable transfer buffers
+static uint8_t spi_head;                             // buffer which is filled
+static uint8_t spi_in_flight;                        // number of queued transactions
+static uint16_t spi_fill;                            // number of bytes in spi_buf[spi_head]
+static uint8_t spi_dc;                               // DC level for spi_buf[spi_head]
+
+/*
+ * Called by the SPI driver before a transaction starts: set the DC level,
+ * which was active when the bytes were sent by u8g2.
+ */
+static void IRAM_ATTR u8g2_esp32_spi_pre_cb(spi_transaction_t *trans) {
+	gpio_set_level(u8g2_esp32_hal.dc, (int)trans->user);
+} // u8g2_esp32_spi_pre_cb
+
+/*
+ * Wait for the oldest queued transaction.
+ */
+static void u8g2_esp32_spi_wait_one(void) {
+	spi_transaction_t *trans;
+	ESP_ERROR_CHECK(spi_device_get_trans_result(handle_spi, &trans, portMAX_DELAY));
+	spi_in_flight--;
+} // u8g2_esp32_spi_wait_one
+
+/*
+ * Queue the current buffer. If all buffers are in flight afterwards, wait until
+ * the next buffer is free again.
+ */
+static void u8g2_esp32_spi_queue(void) {
+	spi_transaction_t *trans;
+	if (spi_fill == 0) {
+		return;
+	}
+	trans = &spi_trans[spi_head];
+	memset(trans, 0, sizeof(spi_transaction_t));
+	trans->length    = 8 * spi_fill; // Number of bits NOT number of bytes.
+	trans->tx_buffer = spi_buf[spi_head];
+	trans->user      = (void *)(int)spi_dc;
+	ESP_ERROR_CHECK(spi_device_queue_trans(handle_spi, trans, portMAX_DELAY));
+	spi_in_flight++;
+	spi_head = (spi_head + 1) % SPI_QUEUE_SIZE;
+	spi_fill = 0;
+	if (spi_in_flight == SPI_QUEUE_SIZE) {
+		u8g2_esp32_spi_wait_one();
+	}
+} // u8g2_esp32_spi_queue
+#endif
+
 /*
  * Initialze the ESP32 HAL.
  */
@@ -26,6 +86,22 @@ void u8g2_esp32_hal_init(u8g2_esp32_hal_t u8g2_esp32_hal_param) {
 	u8g2_esp32_hal = u8g2_esp32_hal_param;
 } // u8g2_esp32_hal_init
 
+/*
+ * Send all pending SPI data and wait until the transfer is done.
+ * Call this before the display is switched off or the CPU goes to sleep.
+ */
+void u8g2_esp32_spi_wait(void) {
+#if SPI_QUEUED_TRANSFER
+	if (handle_spi == NULL) {
+		return;
+	}
+	u8g2_esp32_spi_queue();
+	while (spi_in_flight > 0) {
+		u8g2_esp32_spi_wait_one();
+	}
+#endif
+} // u8g2_esp32_spi_wait
+
 /*
  * HAL callback function as prescribed by the U8G2 library.  This callback is invoked
  * to handle SPI communications.
@@ -35,7 +111,15 @@ uint8_t u8g2_esp32_spi_byte_cb(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void
 	switch(msg) {
 		case U8X8_MSG_BYTE_SET_DC:
 			if (u8g2_esp32_hal.dc != U8G2_ESP32_HAL_UNDEFINED) {
+#if SPI_QUEUED_TRANSFER
+				// the DC level is set by u8g2_esp32_spi_pre_cb
+				if (spi_dc != arg_int) {
+					u8g2_esp32_spi_queue();
+					spi_dc = arg_int;
+				}
+#else
 				gpio_set_level(u8g2_esp32_hal.dc, arg_int);
+#endif
 			}
 			break;
 
@@ -63,12 +147,28 @@ uint8_t u8g2_esp32_spi_byte_cb(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void
 		  dev_config.duty_cycle_pos   = 0;
 		  dev_config.cs_ena_posttrans = 0;
 		  dev_config.cs_ena_pretrans  = 0;
-		  dev_config.clock_speed_hz   = 10000;
+		  dev_config.clock_speed_hz   = SPI_MASTER_FREQ_HZ;
 		  dev_config.spics_io_num     = u8g2_esp32_hal.cs;
 		  dev_config.flags            = 0;
+		  dev_config.post_cb          = NULL;
+#if SPI_QUEUED_TRANSFER
+		  dev_config.queue_size       = SPI_QUEUE_SIZE;
+		  dev_config.pre_cb           = NULL;
+		  if (u8g2_esp32_hal.dc != U8G2_ESP32_HAL_UNDEFINED) {
+			  dev_config.pre_cb       = u8g2_esp32_spi_pre_cb;
+		  }
+		  for (int i = 0; i < SPI_QUEUE_SIZE; i++) {
+			  spi_buf[i] = heap_caps_malloc(SPI_QUEUE_BUF_SIZE, MALLOC_CAP_DMA);
+			  assert(spi_buf[i] != NULL);
+		  }
+		  spi_head      = 0;
+		  spi_in_flight = 0;
+		  spi_fill      = 0;
+		  spi_dc        = 0;
+#else
 		  dev_config.queue_size       = 200;
 		  dev_config.pre_cb           = NULL;
-		  dev_config.post_cb          = NULL;
+#endif
 		  //ESP_LOGI(TAG, "... Adding device bus.");
 		  ESP_ERROR_CHECK(spi_bus_add_device(HSPI_HOST, &dev_config, &handle_spi));
 
@@ -76,6 +176,26 @@ uint8_t u8g2_esp32_spi_byte_cb(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void
 		}
 
 		case U8X8_MSG_BYTE_SEND: {
+#if SPI_QUEUED_TRANSFER
+			uint8_t* data_ptr = (uint8_t*)arg_ptr;
+			uint16_t len;
+
+			// u8g2 may reuse arg_ptr after returning, so the bytes are copied
+			while (arg_int > 0) {
+				len = SPI_QUEUE_BUF_SIZE - spi_fill;
+				if (len > arg_int) {
+					len = arg_int;
+				}
+				memcpy(spi_buf[spi_head] + spi_fill, data_ptr, len);
+				spi_fill += len;
+				data_ptr += len;
+				arg_int  -= len;
+				if (spi_fill == SPI_QUEUE_BUF_SIZE) {
+					u8g2_esp32_spi_queue();
+				}
+			}
+			break;
+#else
 			spi_transaction_t trans_desc;
 			trans_desc.addr      = 0;
 			trans_desc.cmd   	 = 0;
@@ -88,7 +208,16 @@ uint8_t u8g2_esp32_spi_byte_cb(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void
 			//ESP_LOGI(TAG, "... Transmitting %d bytes.", arg_int);
 			ESP_ERROR_CHECK(spi_device_transmit(handle_spi, &trans_desc));
 			break;
+#endif
 		}
+
+#if SPI_QUEUED_TRANSFER
+		case U8X8_MSG_BYTE_END_TRANSFER: {
+			// queue the remaining bytes, but do not wait for the transfer
+			u8g2_esp32_spi_queue();
+			break;
+		}
+#endif
 	}
 	return 0;
 } // u8g2_esp32_spi_byte_cb
@@ -135,6 +264,18 @@ uint8_t u8g2_esp32_i2c_byte_cb(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void
 			uint8_t* data_ptr = (uint8_t*)arg_ptr;
 			ESP_LOG_BUFFER_HEXDUMP(TAG, data_ptr, arg_int, ESP_LOG_VERBOSE);
 
+			// collect the bytes, i2c_master_write() does not copy the data
+			if (i2c_len + arg_int <= I2C_BUF_SIZE) {
+				memcpy(i2c_buf + i2c_len, data_ptr, arg_int);
+				i2c_len += arg_int;
+				break;
+			}
+
+			// buffer is full: add the collected bytes, the remaining bytes are added one by one
+			if (i2c_len > i2c_queued) {
+				ESP_ERROR_CHECK(i2c_master_write(handle_i2c, i2c_buf + i2c_queued, i2c_len - i2c_queued, ACK_CHECK_EN));
+				i2c_queued = i2c_len;
+			}
 			while( arg_int > 0 ) {
 			   ESP_ERROR_CHECK(i2c_master_write_byte(handle_i2c, *data_ptr, ACK_CHECK_EN));
 			   data_ptr++;
@@ -148,12 +289,18 @@ uint8_t u8g2_esp32_i2c_byte_cb(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void
 			handle_i2c = i2c_cmd_link_create();
 			ESP_LOGD(TAG, "Start I2C transfer to %02X.", i2c_address>>1);
 			ESP_ERROR_CHECK(i2c_master_start(handle_i2c));
-			ESP_ERROR_CHECK(i2c_master_write_byte(handle_i2c, i2c_address | I2C_MASTER_WRITE, ACK_CHECK_EN));
+			// the address byte is sent together with the data
+			i2c_buf[0] = i2c_address | I2C_MASTER_WRITE;
+			i2c_len = 1;
+			i2c_queued = 0;
 			break;
 		}
 
 		case U8X8_MSG_BYTE_END_TRANSFER: {
 			ESP_LOGD(TAG, "End I2C transfer.");
+			if (i2c_len > i2c_queued) {
+				ESP_ERROR_CHECK(i2c_master_write(handle_i2c, i2c_buf + i2c_queued, i2c_len - i2c_queued, ACK_CHECK_EN));
+			}
 			ESP_ERROR_CHECK(i2c_master_stop(handle_i2c));
 			ESP_ERROR_CHECK(i2c_master_cmd_begin(I2C_MASTER_NUM, handle_i2c, I2C_TIMEOUT_MS / portTICK_RATE_MS));
 			i2c_cmd_link_delete(handle_i2c);
@@ -200,6 +347,7 @@ uint8_t u8g2_esp32_gpio_and_delay_cb(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int,
 
 	// Set the GPIO reset pin to the value passed in through arg_int.
 		case U8X8_MSG_GPIO_RESET:
+			u8g2_esp32_spi_wait();
 			if (u8g2_esp32_hal.reset != U8G2_ESP32_HAL_UNDEFINED) {
 				gpio_set_level(u8g2_esp32_hal.reset, arg_int);
 			}
@@ -227,6 +375,8 @@ uint8_t u8g2_esp32_gpio_and_delay_cb(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int,
 
 	// Delay for the number of milliseconds passed in through arg_int.
 		case U8X8_MSG_DELAY_MILLI:
+			// queued SPI data must reach the display before the delay starts
+			u8g2_esp32_spi_wait();
 			vTaskDelay(arg_int/portTICK_PERIOD_MS);
 			break;
 	}
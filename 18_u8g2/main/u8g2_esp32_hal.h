@@ -18,10 +18,16 @@
 #define I2C_MASTER_NUM I2C_NUM_1           //  I2C port number for master dev
 #define I2C_MASTER_TX_BUF_DISABLE   0      //  I2C master do not need buffer
 #define I2C_MASTER_RX_BUF_DISABLE   0      //  I2C master do not need buffer
-#define I2C_MASTER_FREQ_HZ          50000  //  I2C master clock frequency
+#define I2C_MASTER_FREQ_HZ          400000 //  I2C master clock frequency (SSD1306: fast mode 400 kHz)
+#define I2C_BUF_SIZE                260    //  bytes collected for one I2C transfer (address + control byte + data)
 #define ACK_CHECK_EN   0x1                 //  I2C master will check ack from slave
 #define ACK_CHECK_DIS  0x0                 //  I2C master will not check ack from slave
 
+#define SPI_MASTER_FREQ_HZ          4000000 //  SPI master clock frequency (SSD1306: max. 10 MHz)
+#define SPI_QUEUED_TRANSFER         1      //  1: queue DMA transactions, 0: blocking spi_device_transmit
+#define SPI_QUEUE_SIZE              8      //  number of queued SPI transactions
+#define SPI_QUEUE_BUF_SIZE          256    //  max. number of bytes per queued SPI transaction
+
 typedef struct {
 	gpio_num_t clk;
 	gpio_num_t mosi;
@@ -38,4 +44,5 @@ void u8g2_esp32_hal_init(u8g2_esp32_hal_t u8g2_esp32_hal_param);
 uint8_t u8g2_esp32_spi_byte_cb(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr);
 uint8_t u8g2_esp32_i2c_byte_cb(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr);
 uint8_t u8g2_esp32_gpio_and_delay_cb(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr);
+void u8g2_esp32_spi_wait(void);
 #endif /* U8G2_ESP32_HAL_H_ */
@@ -0,0 +1,74 @@
+/*
+ * Host build: ESP-IDF definitions used by main.c, the functions are stubs
+ */
+
+#ifndef HOST_ESP_SYSTEM_H_
+#define HOST_ESP_SYSTEM_H_
+
+#include <stdint.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_ERROR_CHECK(x) do { esp_err_t __err = (x); (void)__err; } while (0)
+
+// wifi
+typedef struct { int unused; } wifi_init_config_t;
+#define WIFI_INIT_CONFIG_DEFAULT() { 0 }
+
+typedef union {
+	struct {
+		char ssid[32];
+		char password[64];
+		uint8_t ssid_len;
+		uint8_t channel;
+		int authmode;
+		uint8_t ssid_hidden;
+		uint8_t max_connection;
+		uint16_t beacon_interval;
+	} ap;
+} wifi_config_t;
+
+enum { WIFI_AUTH_OPEN, WIFI_AUTH_WEP, WIFI_AUTH_WPA_PSK, WIFI_AUTH_WPA2_PSK, WIFI_AUTH_WPA_WPA2_PSK, WIFI_AUTH_WPA2_ENTERPRISE };
+enum { WIFI_STORAGE_RAM = 1 };
+enum { WIFI_MODE_AP = 2 };
+enum { WIFI_IF_AP = 1 };
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *config);
+esp_err_t esp_wifi_set_storage(int storage);
+esp_err_t esp_wifi_set_mode(int mode);
+esp_err_t esp_wifi_set_config(int interface, wifi_config_t *config);
+esp_err_t esp_wifi_start(void);
+
+// tcpip adapter
+typedef struct { uint32_t addr; } ip4_addr_t;
+typedef struct { ip4_addr_t ip, netmask, gw; } tcpip_adapter_ip_info_t;
+#define IP4_ADDR(ipaddr, a, b, c, d) ((ipaddr)->addr = ((uint32_t)(d) << 24) | ((c) << 16) | ((b) << 8) | (a))
+enum { TCPIP_ADAPTER_IF_STA, TCPIP_ADAPTER_IF_AP };
+
+void tcpip_adapter_init(void);
+esp_err_t tcpip_adapter_dhcps_start(int interface);
+esp_err_t tcpip_adapter_dhcps_stop(int interface);
+esp_err_t tcpip_adapter_set_ip_info(int interface, tcpip_adapter_ip_info_t *info);
+
+// event loop
+typedef enum { SYSTEM_EVENT_AP_START, SYSTEM_EVENT_AP_STACONNECTED } system_event_id_t;
+typedef struct { system_event_id_t event_id; } system_event_t;
+typedef esp_err_t (*system_event_cb_t)(void *ctx, system_event_t *event);
+esp_err_t esp_event_loop_init(system_event_cb_t cb, void *ctx);
+
+// log, nvs, mdns
+#define ESP_LOG_NONE 0
+void esp_log_level_set(const char *tag, int level);
+esp_err_t nvs_flash_init(void);
+
+typedef struct mdns_server_s mdns_server_t;
+esp_err_t mdns_init(int interface, mdns_server_t **server);
+esp_err_t mdns_set_hostname(mdns_server_t *server, const char *hostname);
+esp_err_t mdns_set_instance(mdns_server_t *server, const char *instance);
+
+// spiffs, /spiffs is mapped to a host directory
+extern const char *host_spiffs_dir;
+void vfs_spiffs_register(void);
+
+#endif /* HOST_ESP_SYSTEM_H_ */
@@ -0,0 +1,2 @@
+/* Host build: see esp_system.h */
+#include "esp_system.h"
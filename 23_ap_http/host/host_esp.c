@@ -0,0 +1,49 @@
+/*
+ * Host build: ESP-IDF stubs, and /spiffs mapped to a host directory
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <fcntl.h>
+
+#include "esp_system.h"
+
+const char *host_spiffs_dir = ".";
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *config) { return ESP_OK; }
+esp_err_t esp_wifi_set_storage(int storage) { return ESP_OK; }
+esp_err_t esp_wifi_set_mode(int mode) { return ESP_OK; }
+esp_err_t esp_wifi_set_config(int interface, wifi_config_t *config) { return ESP_OK; }
+esp_err_t esp_wifi_start(void) { return ESP_OK; }
+void tcpip_adapter_init(void) { }
+esp_err_t tcpip_adapter_dhcps_start(int interface) { return ESP_OK; }
+esp_err_t tcpip_adapter_dhcps_stop(int interface) { return ESP_OK; }
+esp_err_t tcpip_adapter_set_ip_info(int interface, tcpip_adapter_ip_info_t *info) { return ESP_OK; }
+esp_err_t esp_event_loop_init(system_event_cb_t cb, void *ctx) { return ESP_OK; }
+void esp_log_level_set(const char *tag, int level) { }
+esp_err_t nvs_flash_init(void) { return ESP_OK; }
+esp_err_t mdns_init(int interface, mdns_server_t **server) { return ESP_OK; }
+esp_err_t mdns_set_hostname(mdns_server_t *server, const char *hostname) { return ESP_OK; }
+esp_err_t mdns_set_instance(mdns_server_t *server, const char *instance) { return ESP_OK; }
+void vfs_spiffs_register(void) { }
+
+// open() is wrapped at link time: /spiffs/<name> opens <host_spiffs_dir>/<name>
+int __real_open(const char *path, int flags, ...);
+
+int __wrap_open(const char *path, int flags, ...) {
+	char host_path[256];
+	va_list ap;
+	int mode = 0;
+
+	if (flags & O_CREAT) {
+		va_start(ap, flags);
+		mode = va_arg(ap, int);
+		va_end(ap);
+	}
+	if (strncmp(path, "/spiffs/", 8) == 0) {
+		snprintf(host_path, sizeof(host_path), "%s/%s", host_spiffs_dir, path + 8);
+		return __real_open(host_path, flags, mode);
+	}
+	return __real_open(path, flags, mode);
+}
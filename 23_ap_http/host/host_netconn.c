@@ -0,0 +1,111 @@
+/*
+ * Host build: lwIP netconn API on BSD sockets
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "lwip/api.h"
+
+u16_t host_netconn_http_port = 8080;
+uint32_t host_netconn_write_delay_us = 0;
+
+struct netconn *netconn_new(int type) {
+	struct netconn *conn = calloc(1, sizeof(struct netconn));
+	int one = 1;
+
+	conn->fd = socket(AF_INET, SOCK_STREAM, 0);
+	setsockopt(conn->fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	return conn;
+}
+
+err_t netconn_bind(struct netconn *conn, const void *addr, u16_t port) {
+	struct sockaddr_in sa;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sin_family = AF_INET;
+	sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	sa.sin_port = htons(port == 80 ? host_netconn_http_port : port);
+	return bind(conn->fd, (struct sockaddr *)&sa, sizeof(sa)) == 0 ? ERR_OK : ERR_VAL;
+}
+
+err_t netconn_listen(struct netconn *conn) {
+	return listen(conn->fd, 64) == 0 ? ERR_OK : ERR_VAL;
+}
+
+err_t netconn_accept(struct netconn *conn, struct netconn **new_conn) {
+	int one = 1;
+	int fd = accept(conn->fd, NULL, NULL);
+
+	if (fd < 0) return ERR_CONN;
+	// lwIP on the ESP32 sends small segments without delay too
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	*new_conn = calloc(1, sizeof(struct netconn));
+	(*new_conn)->fd = fd;
+	return ERR_OK;
+}
+
+err_t netconn_recv(struct netconn *conn, struct netbuf **buf) {
+	struct pollfd pfd = { .fd = conn->fd, .events = POLLIN };
+	struct netbuf *nb;
+	ssize_t len;
+
+	if (poll(&pfd, 1, conn->recv_timeout ? conn->recv_timeout : -1) == 0) return ERR_TIMEOUT;
+
+	nb = malloc(sizeof(struct netbuf));
+	len = recv(conn->fd, nb->data, sizeof(nb->data), 0);
+	if (len <= 0) {
+		free(nb);
+		return len == 0 ? ERR_CLSD : ERR_RST;
+	}
+	nb->len = len;
+	*buf = nb;
+	return ERR_OK;
+}
+
+err_t netconn_write(struct netconn *conn, const void *data, size_t size, u8_t flags) {
+	const char *p = data;
+
+	if (host_netconn_write_delay_us) usleep(host_netconn_write_delay_us);
+	while (size > 0) {
+		ssize_t len = send(conn->fd, p, size, MSG_NOSIGNAL | ((flags & NETCONN_MORE) ? MSG_MORE : 0));
+		if (len < 0) {
+			if (errno == EINTR) continue;
+			return ERR_RST;
+		}
+		p += len;
+		size -= len;
+	}
+	return ERR_OK;
+}
+
+err_t netconn_close(struct netconn *conn) {
+	shutdown(conn->fd, SHUT_RDWR);
+	return ERR_OK;
+}
+
+err_t netconn_delete(struct netconn *conn) {
+	close(conn->fd);
+	free(conn);
+	return ERR_OK;
+}
+
+err_t netbuf_data(struct netbuf *buf, void **data, u16_t *len) {
+	*data = buf->data;
+	*len = buf->len;
+	return ERR_OK;
+}
+
+int8_t netbuf_next(struct netbuf *buf) {
+	return -1;
+}
+
+void netbuf_delete(struct netbuf *buf) {
+	free(buf);
+}
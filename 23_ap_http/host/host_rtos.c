@@ -0,0 +1,160 @@
+/*
+ * Host build: FreeRTOS tasks, queues and semaphores on POSIX threads
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "freertos/FreeRTOS.h"
+
+struct host_queue {
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	UBaseType_t length;
+	UBaseType_t item_size;
+	UBaseType_t head;
+	UBaseType_t count;
+	uint8_t *items;
+};
+
+typedef struct {
+	void (*task)(void *);
+	void *parameters;
+} host_task_t;
+
+static void *host_task_start(void *arg) {
+	host_task_t t = *(host_task_t *)arg;
+
+	free(arg);
+	t.task(t.parameters);
+	return NULL;
+}
+
+BaseType_t xTaskCreate(void (*task)(void *), const char *name, uint32_t stack_depth,
+		void *parameters, UBaseType_t priority, TaskHandle_t *handle) {
+	pthread_t thread;
+	host_task_t *t = malloc(sizeof(host_task_t));
+
+	t->task = task;
+	t->parameters = parameters;
+	if (pthread_create(&thread, NULL, host_task_start, t) != 0) {
+		free(t);
+		return pdFAIL;
+	}
+	pthread_detach(thread);
+	if (handle) *handle = (TaskHandle_t)thread;
+	return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+	if (task == NULL) pthread_exit(NULL);
+}
+
+void vTaskDelay(TickType_t ticks) {
+	usleep(ticks * portTICK_PERIOD_MS * 1000);
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+	QueueHandle_t queue = calloc(1, sizeof(struct host_queue));
+
+	pthread_mutex_init(&queue->lock, NULL);
+	pthread_cond_init(&queue->changed, NULL);
+	queue->length = length;
+	queue->item_size = item_size;
+	queue->items = calloc(length, item_size ? item_size : 1);
+	return queue;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count) {
+	QueueHandle_t queue = xQueueCreate(max_count, 0);
+
+	queue->count = initial_count;
+	return queue;
+}
+
+// waits until cond holds, returns 0 on timeout
+static int host_queue_wait(QueueHandle_t queue, int full, TickType_t ticks) {
+	struct timespec deadline;
+
+	if (ticks != portMAX_DELAY) {
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += ticks / 1000;
+		deadline.tv_nsec += (ticks % 1000) * 1000000L;
+		if (deadline.tv_nsec >= 1000000000L) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000L;
+		}
+	}
+	while (full ? queue->count == queue->length : queue->count == 0) {
+		if (ticks == 0) return 0;
+		if (ticks == portMAX_DELAY) {
+			pthread_cond_wait(&queue->changed, &queue->lock);
+		}
+		else if (pthread_cond_timedwait(&queue->changed, &queue->lock, &deadline) == ETIMEDOUT) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks) {
+	pthread_mutex_lock(&queue->lock);
+	if (!host_queue_wait(queue, 1, ticks)) {
+		pthread_mutex_unlock(&queue->lock);
+		return pdFAIL;
+	}
+	if (queue->item_size) {
+		memcpy(queue->items + ((queue->head + queue->count) % queue->length) * queue->item_size,
+				item, queue->item_size);
+	}
+	queue->count++;
+	pthread_cond_broadcast(&queue->changed);
+	pthread_mutex_unlock(&queue->lock);
+	return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks) {
+	pthread_mutex_lock(&queue->lock);
+	if (!host_queue_wait(queue, 0, ticks)) {
+		pthread_mutex_unlock(&queue->lock);
+		return pdFAIL;
+	}
+	if (queue->item_size) {
+		memcpy(item, queue->items + queue->head * queue->item_size, queue->item_size);
+		queue->head = (queue->head + 1) % queue->length;
+	}
+	queue->count--;
+	pthread_cond_broadcast(&queue->changed);
+	pthread_mutex_unlock(&queue->lock);
+	return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+	UBaseType_t count;
+
+	pthread_mutex_lock(&queue->lock);
+	count = queue->count;
+	pthread_mutex_unlock(&queue->lock);
+	return count;
+}
+
+EventGroupHandle_t xEventGroupCreate(void) {
+	return NULL;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+	return 0;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+	return 0;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits,
+		BaseType_t clear, BaseType_t all, TickType_t ticks) {
+	return 0;
+}
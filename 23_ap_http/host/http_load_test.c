@@ -0,0 +1,345 @@
+/*
+ * HTTP server load test (host build)
+ *
+ * Runs the server of main.c on the host and replays browser style page
+ * loads: every browser fetches index.html, then the page assets over its
+ * parallel connections, reusing them between page loads.
+ *
+ * usage: http_load_test [-b browsers] [-c connections] [-n pages] [-P depth]
+ *                       [-k] [-d delay_us] [-w www_dir] [-p port]
+ *
+ *   -b  concurrent browsers (default 1)
+ *   -c  connections per browser (default 6, like most browsers)
+ *   -n  page loads per browser (default 50)
+ *   -P  requests pipelined per connection (default 1, no pipelining)
+ *   -k  no keep-alive, a new connection for every request
+ *   -d  delay of every server write in us, emulates a slow link (default 0)
+ *   -w  directory served as /spiffs (default: a generated site)
+ *   -p  TCP port of the server (default 8080)
+ *
+ * The number of workers is set at build time: make WORKERS=1
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <dirent.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include "../main/main.c"
+
+#define MAX_ASSETS 32
+#define MAX_CONNECTIONS 16
+#define MAX_PAGES 10000
+
+typedef struct {
+	int index;
+	int fd;
+	uint64_t bytes;
+	uint32_t requests;
+	uint32_t refused;
+	uint32_t errors;
+	struct browser *browser;
+} connection_t;
+
+typedef struct browser {
+	pthread_barrier_t start;
+	pthread_barrier_t index_done;
+	pthread_barrier_t done;
+	double page_ms[MAX_PAGES];
+	connection_t conns[MAX_CONNECTIONS];
+} browser_t;
+
+static char assets[MAX_ASSETS][HTTP_RESOURCE_MAX];
+static int asset_count = 0;
+static int connections = 6;
+static int pages = 50;
+static int pipeline = 1;
+static int keep_alive = 1;
+
+static double now_ms(void) {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+// writes a file of the given size into the site directory
+static void site_file(const char *dir, const char *name, int size) {
+	char path[256];
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	FILE *f = fopen(path, "w");
+	for(int i = 0; i < size; i++) fputc('a' + (i * 7) % 26, f);
+	fclose(f);
+}
+
+// a page like the examples of the tutorial: html, css, scripts and images
+static const char *site_generate(void) {
+	static char dir[] = "/tmp/http_load_test_XXXXXX";
+	if(!mkdtemp(dir)) return NULL;
+	site_file(dir, "index.html", 4096);
+	site_file(dir, "style.css", 6144);
+	site_file(dir, "app.js", 24576);
+	site_file(dir, "app.js.gz", 7168);
+	site_file(dir, "logo.png", 12288);
+	site_file(dir, "icon1.png", 2048);
+	site_file(dir, "icon2.png", 2048);
+	site_file(dir, "icon3.png", 2048);
+	site_file(dir, "icon4.png", 2048);
+	site_file(dir, "favicon.ico", 1024);
+	return dir;
+}
+
+// removes the generated site
+static void site_remove(const char *dir) {
+	DIR *d = opendir(dir);
+	struct dirent *de;
+	char path[512];
+	while(d && (de = readdir(d))) {
+		if(de->d_name[0] == '.') continue;
+		snprintf(path, sizeof(path), "%s/%s", dir, de->d_name);
+		unlink(path);
+	}
+	if(d) closedir(d);
+	rmdir(dir);
+}
+
+// the page assets are all the files of the site except index.html
+static void site_assets(const char *dir) {
+	DIR *d = opendir(dir);
+	struct dirent *de;
+	while(d && (de = readdir(d)) && asset_count < MAX_ASSETS) {
+		if(de->d_name[0] == '.' || strcmp(de->d_name, "index.html") == 0) continue;
+		size_t len = strlen(de->d_name);
+		if(len > 3 && strcmp(de->d_name + len - 3, ".gz") == 0) continue;
+		if(len + 1 >= HTTP_RESOURCE_MAX) continue;
+		assets[asset_count][0] = '/';
+		strcpy(assets[asset_count++] + 1, de->d_name);
+	}
+	if(d) closedir(d);
+}
+
+static int client_connect(void) {
+	struct sockaddr_in sa;
+	int one = 1;
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	memset(&sa, 0, sizeof(sa));
+	sa.sin_family = AF_INET;
+	sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	sa.sin_port = htons(host_netconn_http_port);
+	if(connect(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0) {
+		close(fd);
+		return -1;
+	}
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	return fd;
+}
+
+// reads one response, returns the status code, 0 if the connection was closed
+// before any byte of the response arrived, -1 on errors
+static int client_response(connection_t *c, int *close_after) {
+	char header[1024];
+	size_t len = 0;
+	char *end = NULL;
+
+	// read byte by byte up to the end of the headers, the body follows
+	while(!end) {
+		if(len == sizeof(header) - 1) return -1;
+		ssize_t n = recv(c->fd, header + len, 1, 0);
+		if(n <= 0) return len == 0 ? 0 : -1;
+		len += n;
+		header[len] = '\0';
+		end = strstr(header, "\r\n\r\n");
+	}
+
+	int status = atoi(header + 9);
+	char *cl = strcasestr(header, "\r\nContent-Length:");
+	long body = cl ? strtol(cl + 17, NULL, 10) : 0;
+	*close_after = strcasestr(header, "\r\nConnection: close") != NULL;
+
+	char buf[4096];
+	while(body > 0) {
+		ssize_t n = recv(c->fd, buf, body < (long)sizeof(buf) ? body : (long)sizeof(buf), 0);
+		if(n <= 0) return -1;
+		body -= n;
+		c->bytes += n;
+	}
+	c->bytes += len;
+	return status;
+}
+
+// fetches the resources over the connection, reconnecting like a browser
+// when a kept connection was closed by the server
+static void client_fetch(connection_t *c, char (*resources)[HTTP_RESOURCE_MAX], int count) {
+	int done = 0;
+	int retries = 0;
+
+	while(done < count) {
+
+		if(c->fd < 0) {
+			c->fd = client_connect();
+			if(c->fd < 0) {
+				c->errors++;
+				return;
+			}
+		}
+
+		// send a batch of pipelined requests
+		int batch = pipeline > 0 ? pipeline : count;
+		if(batch > count - done) batch = count - done;
+		if(!keep_alive) batch = 1;
+		char req[4096];
+		size_t len = 0;
+		for(int i = 0; i < batch; i++) {
+			len += sprintf(req + len, "GET %s HTTP/1.1\r\nHost: 192.168.1.1\r\n"
+				"User-Agent: http_load_test\r\nAccept: */*\r\nAccept-Encoding: gzip, deflate\r\n"
+				"Connection: %s\r\n\r\n", resources[done + i], keep_alive ? "keep-alive" : "close");
+		}
+		send(c->fd, req, len, MSG_NOSIGNAL);
+
+		int got = 0;
+		int close_after = 0;
+		while(got < batch) {
+			int status = client_response(c, &close_after);
+			if(status <= 0) break;
+			if(status == 503) {
+				c->refused++;
+				close_after = 1;
+				break;
+			}
+			c->requests++;
+			got++;
+			if(close_after) break;
+		}
+		done += got;
+
+		// a closed or refused connection is opened again
+		if(got < batch || close_after) {
+			close(c->fd);
+			c->fd = -1;
+			if(got == 0 && ++retries > 100) {
+				c->errors++;
+				return;
+			}
+			if(got == 0) usleep(1000);
+		}
+	}
+}
+
+static void *client_connection(void *arg) {
+	connection_t *c = arg;
+	browser_t *b = c->browser;
+	char index[1][HTTP_RESOURCE_MAX] = { "/" };
+	char mine[MAX_ASSETS][HTTP_RESOURCE_MAX];
+	int count = 0;
+
+	// the assets are spread over the connections
+	for(int i = c->index; i < asset_count; i += connections) strcpy(mine[count++], assets[i]);
+
+	c->fd = -1;
+	for(int p = 0; p < pages; p++) {
+		pthread_barrier_wait(&b->start);
+		double t0 = now_ms();
+		if(c->index == 0) client_fetch(c, index, 1);
+		pthread_barrier_wait(&b->index_done);
+		client_fetch(c, mine, count);
+		pthread_barrier_wait(&b->done);
+		if(c->index == 0) b->page_ms[p] = now_ms() - t0;
+	}
+	if(c->fd >= 0) close(c->fd);
+	return NULL;
+}
+
+static void *client_browser(void *arg) {
+	browser_t *b = arg;
+	pthread_t threads[MAX_CONNECTIONS];
+
+	pthread_barrier_init(&b->start, NULL, connections);
+	pthread_barrier_init(&b->index_done, NULL, connections);
+	pthread_barrier_init(&b->done, NULL, connections);
+	for(int i = 0; i < connections; i++) {
+		b->conns[i].index = i;
+		b->conns[i].browser = b;
+		pthread_create(&threads[i], NULL, client_connection, &b->conns[i]);
+	}
+	for(int i = 0; i < connections; i++) pthread_join(threads[i], NULL);
+	return NULL;
+}
+
+static int cmp_double(const void *a, const void *b) {
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv) {
+	int browsers = 1;
+	const char *www = NULL;
+	int opt;
+
+	while((opt = getopt(argc, argv, "b:c:n:P:kd:w:p:")) != -1) {
+		switch(opt) {
+			case 'b': browsers = atoi(optarg); break;
+			case 'c': connections = atoi(optarg); break;
+			case 'n': pages = atoi(optarg); break;
+			case 'P': pipeline = atoi(optarg); break;
+			case 'k': keep_alive = 0; break;
+			case 'd': host_netconn_write_delay_us = atoi(optarg); break;
+			case 'w': www = optarg; break;
+			case 'p': host_netconn_http_port = atoi(optarg); break;
+			default:
+				fprintf(stderr, "usage: %s [-b browsers] [-c connections] [-n pages] [-P depth] [-k] [-d delay_us] [-w www_dir] [-p port]\n", argv[0]);
+				return 2;
+		}
+	}
+	if(connections < 1 || connections > MAX_CONNECTIONS || pages < 1 || pages > MAX_PAGES) return 2;
+
+	host_spiffs_dir = www ? www : site_generate();
+	site_assets(host_spiffs_dir);
+
+	// the server logs every request, keep the output for the results
+	if(!freopen("/dev/null", "w", stdout)) return 1;
+	static_content_init();
+	xTaskCreate(&http_server, "http_server", 2048, NULL, 5, NULL);
+	for(int i = 0; i < 100; i++) {
+		int fd = client_connect();
+		if(fd >= 0) {
+			close(fd);
+			break;
+		}
+		usleep(10000);
+	}
+
+	browser_t *b = calloc(browsers, sizeof(browser_t));
+	pthread_t *threads = calloc(browsers, sizeof(pthread_t));
+	double t0 = now_ms();
+	for(int i = 0; i < browsers; i++) pthread_create(&threads[i], NULL, client_browser, &b[i]);
+	for(int i = 0; i < browsers; i++) pthread_join(threads[i], NULL);
+	double elapsed = now_ms() - t0;
+
+	uint64_t bytes = 0;
+	uint32_t requests = 0, refused = 0, errors = 0;
+	double *page_ms = calloc(browsers * pages, sizeof(double));
+	for(int i = 0; i < browsers; i++) {
+		for(int j = 0; j < connections; j++) {
+			bytes += b[i].conns[j].bytes;
+			requests += b[i].conns[j].requests;
+			refused += b[i].conns[j].refused;
+			errors += b[i].conns[j].errors;
+		}
+		memcpy(page_ms + i * pages, b[i].page_ms, pages * sizeof(double));
+	}
+	qsort(page_ms, browsers * pages, sizeof(double), cmp_double);
+
+	fprintf(stderr, "%d workers, %d browsers x %d connections, pipeline %d, %s, write delay %u us\n",
+		HTTP_WORKERS, browsers, connections, pipeline, keep_alive ? "keep-alive" : "close",
+		host_netconn_write_delay_us);
+	fprintf(stderr, "%u requests in %.0f ms: %.0f req/s, %.2f MB/s\n", requests, elapsed,
+		requests * 1000.0 / elapsed, bytes / 1048576.0 / (elapsed / 1000.0));
+	fprintf(stderr, "page load: p50 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+		page_ms[browsers * pages / 2], page_ms[browsers * pages * 99 / 100], page_ms[browsers * pages - 1]);
+	fprintf(stderr, "refused (503) %u, errors %u\n", refused, errors);
+	if(!www) site_remove(host_spiffs_dir);
+	return errors ? 1 : 0;
+}
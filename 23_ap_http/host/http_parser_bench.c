@@ -0,0 +1,493 @@
+/*
+ * HTTP request parser benchmark and fuzzer (host build)
+ *
+ * Benchmark: parses and routes browser style requests and reports the
+ * requests handled per second by
+ *
+ *   strtok      the previous request handling of main.c (copy into a request
+ *               buffer, strstr for the end of the headers, strtok and a
+ *               header scan per value)
+ *   parser      http_parser_feed on whole requests, then http_router_dispatch
+ *   parser/seg  the same, with the requests split in small random segments
+ *
+ * Fuzzer: generates valid requests, pipelined in a stream, and checks that
+ * the parser returns what was generated whatever the segment boundaries;
+ * then mutates the streams at random and checks that a stream parsed in
+ * segments gives the same results as the whole stream. Build it with
+ * make SANITIZE=1 to run it under AddressSanitizer and UBSan.
+ *
+ * usage: http_parser_bench [-n requests] [-f iterations] [-s seed]
+ *
+ *   -n  requests parsed by each benchmark (default 1000000)
+ *   -f  fuzz iterations, 0 to skip the fuzzer (default 100000)
+ *   -s  random seed (default 1)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "http_parser.h"
+
+#define LEGACY_BUFFER_SIZE 1024
+#define MAX_RESULTS 8
+#define STREAM_MAX 8192
+
+// requests of a page load, as sent by a desktop browser
+static const char *paths[] = {
+	"/", "/style.css", "/app.js", "/img/logo.png", "/img/bg.jpg", "/favicon.ico",
+	"/api/status?t=1521", "/missing.html",
+};
+#define PATH_COUNT (int)(sizeof(paths) / sizeof(paths[0]))
+
+static const char request_fmt[] =
+	"GET %s HTTP/1.1\r\n"
+	"Host: 192.168.1.1\r\n"
+	"Connection: keep-alive\r\n"
+	"User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/64.0.3282.167 Safari/537.36\r\n"
+	"Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/webp,image/apng,*/*;q=0.8\r\n"
+	"Referer: http://192.168.1.1/\r\n"
+	"Accept-Encoding: gzip, deflate\r\n"
+	"Accept-Language: it-IT,it;q=0.9,en-US;q=0.8,en;q=0.7\r\n"
+	"If-None-Match: \"5d2f0a17\"\r\n"
+	"\r\n";
+
+static char requests[PATH_COUNT][1024];
+static size_t request_lens[PATH_COUNT];
+
+static const char * const capture[] = { "If-None-Match", "Accept-Encoding" };
+#define CAPTURE_COUNT 2
+
+static volatile uint32_t sink;
+
+static double now_ms(void) {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+// xorshift, the libc rand() is too slow for the segment sizes
+static uint32_t rng_state = 1;
+static uint32_t rng(void) {
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+// previous request handling of main.c
+
+static int legacy_header_value(const char *headers, const char *name, char *value, size_t value_size) {
+
+	size_t name_len = strlen(name);
+	const char *line = headers;
+	while(line && *line) {
+		if(strncasecmp(line, name, name_len) == 0 && line[name_len] == ':') {
+			const char *start = line + name_len + 1;
+			while(*start == ' ') start++;
+			size_t len = strcspn(start, "\r\n");
+			if(len >= value_size) len = value_size - 1;
+			memcpy(value, start, len);
+			value[len] = '\0';
+			return 1;
+		}
+		line = strchr(line, '\n');
+		if(line) line++;
+	}
+	return 0;
+}
+
+static size_t legacy_request_length(char *request, size_t len) {
+
+	char *end = strstr(request, "\r\n\r\n");
+	if(!end) return 0;
+	size_t request_len = end + 4 - request;
+	char value[16];
+	*end = '\0';
+	if(legacy_header_value(request, "Content-Length", value, sizeof(value))) request_len += strtoul(value, NULL, 10);
+	*end = '\r';
+	return request_len <= len ? request_len : 0;
+}
+
+static int legacy_handle(char *request) {
+
+	char value[64];
+	int keep_alive = strstr(request, " HTTP/1.1\r\n") != NULL;
+	if(legacy_header_value(request, "Connection", value, sizeof(value))) {
+		if(strcasecmp(value, "close") == 0) keep_alive = 0;
+		else if(strcasecmp(value, "keep-alive") == 0) keep_alive = 1;
+	}
+	char *headers = strchr(request, '\n');
+	char *request_line = strtok(request, "\n");
+	if(headers) headers++;
+	if(!request_line) return 0;
+
+	char *method = strtok(request_line, " ");
+	char *resource = strtok(NULL, " ");
+	if(!method || !resource) return 0;
+	char *query = strchr(resource, '?');
+	if(query) *query = '\0';
+	if(strcmp(resource, "/") == 0) resource = "/index.html";
+
+	// the values spiffs_serve looked up
+	int gzip = legacy_header_value(headers, "Accept-Encoding", value, sizeof(value)) && strstr(value, "gzip");
+	int etag = legacy_header_value(headers, "If-None-Match", value, sizeof(value));
+	sink += resource[1] + gzip + etag + (method[0] == 'H');
+	return keep_alive;
+}
+
+static double bench_legacy(int count) {
+
+	static char buffer[LEGACY_BUFFER_SIZE];
+	size_t len = 0;
+	double t0 = now_ms();
+
+	for(int n = 0; n < count; n++) {
+		const char *data = requests[n % PATH_COUNT];
+		size_t data_len = request_lens[n % PATH_COUNT];
+		memcpy(buffer + len, data, data_len);
+		len += data_len;
+		buffer[len] = '\0';
+
+		size_t request_len;
+		while((request_len = legacy_request_length(buffer, len)) > 0) {
+			char next = buffer[request_len];
+			buffer[request_len] = '\0';
+			legacy_handle(buffer);
+			buffer[request_len] = next;
+			len -= request_len;
+			memmove(buffer, buffer + request_len, len + 1);
+		}
+	}
+	return now_ms() - t0;
+}
+
+// parser and route table
+
+static int route_handler(http_parser_t *request, void *ctx) {
+
+	const char *encoding = http_parser_value(request, 1);
+	sink += request->path[1] + (strstr(encoding, "gzip") != NULL) + (http_parser_value(request, 0)[0] != '\0');
+	return request->keep_alive;
+}
+
+static const http_route_t routes[] = {
+	{ HTTP_METHOD_ANY, "/", route_handler },
+	{ HTTP_METHOD_GET, "/api/status", route_handler },
+	{ HTTP_METHOD_POST, "/api/status", route_handler },
+};
+
+static http_router_t router;
+
+static double bench_parser(int count, size_t max_segment) {
+
+	http_parser_t parser;
+	http_parser_init(&parser, capture, CAPTURE_COUNT);
+	double t0 = now_ms();
+
+	for(int n = 0; n < count; n++) {
+		const char *data = requests[n % PATH_COUNT];
+		size_t left = request_lens[n % PATH_COUNT];
+		while(left > 0) {
+			size_t segment = max_segment ? 1 + rng() % max_segment : left;
+			if(segment > left) segment = left;
+			while(segment > 0) {
+				size_t consumed;
+				http_parser_status_t status = http_parser_feed(&parser, data, segment, &consumed);
+				data += consumed;
+				left -= consumed;
+				segment -= consumed;
+				if(status == HTTP_PARSER_DONE) {
+					http_router_dispatch(&router, &parser, NULL);
+					http_parser_reset(&parser);
+				}
+				else if(status == HTTP_PARSER_ERROR) {
+					fprintf(stderr, "benchmark request rejected: %s\n", http_parser_error_status(parser.error));
+					exit(1);
+				}
+			}
+		}
+	}
+	return now_ms() - t0;
+}
+
+// fuzzer
+
+typedef struct {
+	int status;
+	http_method_t method;
+	char path[HTTP_PARSER_PATH_MAX];
+	char query[HTTP_PARSER_PATH_MAX];
+	int has_query;
+	int version_minor;
+	int keep_alive;
+	uint32_t content_length;
+	uint32_t path_hash;
+	http_error_t error;
+	char values[CAPTURE_COUNT][HTTP_PARSER_VALUE_MAX];
+} result_t;
+
+typedef struct {
+	result_t results[MAX_RESULTS];
+	int count;
+	int started;		// an incomplete request is left
+} stream_result_t;
+
+static void result_save(result_t *r, const http_parser_t *parser, int status) {
+
+	memset(r, 0, sizeof(*r));
+	r->status = status;
+	r->error = parser->error;
+	if(status != HTTP_PARSER_DONE) return;
+	r->method = parser->method;
+	strcpy(r->path, parser->path);
+	if(parser->query) {
+		r->has_query = 1;
+		strcpy(r->query, parser->query);
+	}
+	r->version_minor = parser->version_minor;
+	r->keep_alive = parser->keep_alive;
+	r->content_length = parser->content_length;
+	r->path_hash = parser->path_hash;
+	for(int i = 0; i < CAPTURE_COUNT; i++) strcpy(r->values[i], http_parser_value(parser, i));
+}
+
+// parse a stream in segments of 1 to max_segment bytes, 0 for the whole stream
+static void parse_stream(const char *data, size_t len, size_t max_segment, stream_result_t *out) {
+
+	http_parser_t parser;
+	http_parser_init(&parser, capture, CAPTURE_COUNT);
+	out->count = 0;
+
+	while(len > 0 && out->count < MAX_RESULTS) {
+		size_t segment = max_segment ? 1 + rng() % max_segment : len;
+		if(segment > len) segment = len;
+
+		// a copy of the segment only, so reads past it are caught by ASan
+		char *copy = malloc(segment);
+		memcpy(copy, data, segment);
+		size_t offset = 0;
+		while(offset < segment && out->count < MAX_RESULTS) {
+			size_t consumed;
+			http_parser_status_t status = http_parser_feed(&parser, copy + offset, segment - offset, &consumed);
+			if(consumed > segment - offset) {
+				fprintf(stderr, "consumed %zu of %zu bytes\n", consumed, segment - offset);
+				exit(1);
+			}
+			offset += consumed;
+			if(status == HTTP_PARSER_DONE) {
+				result_save(&out->results[out->count++], &parser, status);
+				http_parser_reset(&parser);
+			}
+			else if(status == HTTP_PARSER_ERROR) {
+				result_save(&out->results[out->count++], &parser, status);
+				free(copy);
+				out->started = 0;
+				return;
+			}
+		}
+		free(copy);
+		data += offset;
+		len -= offset;
+	}
+	out->started = http_parser_started(&parser);
+}
+
+static int stream_equal(const stream_result_t *a, const stream_result_t *b) {
+
+	if(a->count != b->count || a->started != b->started) return 0;
+	return memcmp(a->results, b->results, a->count * sizeof(result_t)) == 0;
+}
+
+static void random_string(char *s, int len, const char *chars) {
+
+	size_t n = strlen(chars);
+	for(int i = 0; i < len; i++) s[i] = chars[rng() % n];
+	s[len] = '\0';
+}
+
+static void random_case(char *s) {
+
+	for(; *s; s++) {
+		if(rng() & 1) *s = (*s >= 'a' && *s <= 'z') ? *s - 32 : ((*s >= 'A' && *s <= 'Z') ? *s + 32 : *s);
+	}
+}
+
+static const char *method_names[] = { NULL, "GET", "HEAD", "POST", "PUT", "DELETE", "OPTIONS", "PATCH" };
+
+// append a valid request to the stream, the expected result in r
+static size_t generate_request(char *out, result_t *r) {
+
+	const char *path_chars = "abcdefghijklmnopqrstuvwxyz0123456789/._-%";
+	const char *value_chars = "abcdefghijklmnopqrstuvwxyzABCDEF0123456789\"*,;=/ ";
+	char line[256];
+	size_t len = 0;
+
+	memset(r, 0, sizeof(*r));
+	r->status = HTTP_PARSER_DONE;
+	int m = 1 + rng() % 7;
+	r->method = m < 7 ? (http_method_t)m : HTTP_METHOD_UNKNOWN;
+
+	r->path[0] = '/';
+	random_string(r->path + 1, rng() % 40, path_chars);
+	r->path_hash = http_path_hash(r->path);
+	char target[HTTP_PARSER_PATH_MAX * 2];
+	strcpy(target, r->path);
+	if(rng() % 4 == 0) {
+		r->has_query = 1;
+		random_string(r->query, rng() % (HTTP_PARSER_PATH_MAX - 2 - strlen(r->path)), "abc=&?0123456789");
+		strcat(target, "?");
+		strcat(target, r->query);
+	}
+
+	// blank lines before a request are allowed
+	if(rng() % 8 == 0) len += sprintf(out + len, "\r\n");
+	r->version_minor = rng() % 2;
+	r->keep_alive = r->version_minor;
+	len += sprintf(out + len, "%s %s HTTP/1.%d%s", method_names[m], target, r->version_minor, rng() % 8 ? "\r\n" : "\n");
+
+	int headers = rng() % 12;
+	for(int h = 0; h < headers; h++) {
+		char name[64], value[64];
+		int kind = rng() % 6;
+		int ws = rng() % 3;
+		random_string(value, rng() % (HTTP_PARSER_VALUE_MAX - 1), value_chars);
+		if(kind < CAPTURE_COUNT) {
+			strcpy(name, capture[kind]);
+			int end = strlen(value);
+			while(end > 0 && value[end - 1] == ' ') end--;
+			value[end] = '\0';
+			char *start = value;
+			while(*start == ' ') start++;
+			memset(r->values[kind], 0, HTTP_PARSER_VALUE_MAX);
+			strcpy(r->values[kind], start);
+		}
+		else if(kind == 2) {
+			strcpy(name, "Connection");
+			r->keep_alive = rng() % 2;
+			strcpy(value, r->keep_alive ? "keep-alive" : "close");
+		}
+		else {
+			random_string(name, 1 + rng() % 40, "abcdefghijklmnopqrstuvwxyz-");
+			if(strcasecmp(name, "connection") == 0 || strcasecmp(name, "content-length") == 0) strcpy(name, "x");
+		}
+		random_case(name);
+		sprintf(line, "%s:%s%s%s\r\n", name, ws == 0 ? "" : (ws == 1 ? " " : " \t "), value, ws == 2 ? " " : "");
+		len += sprintf(out + len, "%s", line);
+	}
+
+	if(rng() % 4 == 0) {
+		r->content_length = rng() % 300;
+		len += sprintf(out + len, "Content-Length: %u\r\n", r->content_length);
+	}
+	len += sprintf(out + len, "\r\n");
+	for(uint32_t i = 0; i < r->content_length; i++) out[len++] = rng();
+	return len;
+}
+
+static void fuzz_fail(const char *what, const char *stream, size_t len) {
+
+	fprintf(stderr, "fuzz: %s, stream of %zu bytes:\n", what, len);
+	fwrite(stream, 1, len, stderr);
+	fprintf(stderr, "\n");
+	exit(1);
+}
+
+static void fuzz(int iterations) {
+
+	static char stream[STREAM_MAX];
+	stream_result_t expected, whole, split;
+	int mutated_errors = 0;
+
+	for(int it = 0; it < iterations; it++) {
+
+		// valid pipelined requests
+		size_t len = 0;
+		int count = 1 + rng() % 3;
+		for(int i = 0; i < count; i++) len += generate_request(stream + len, &expected.results[i]);
+		expected.count = count;
+		expected.started = 0;
+
+		parse_stream(stream, len, 0, &whole);
+		if(!stream_equal(&expected, &whole)) fuzz_fail("unexpected result", stream, len);
+		parse_stream(stream, len, 1 + rng() % 16, &split);
+		if(!stream_equal(&whole, &split)) fuzz_fail("segments change the result", stream, len);
+
+		// a truncated stream leaves an incomplete request
+		size_t cut = rng() % len;
+		parse_stream(stream, cut, 1 + rng() % 16, &split);
+		parse_stream(stream, cut, 0, &whole);
+		if(!stream_equal(&whole, &split)) fuzz_fail("segments change the result (truncated)", stream, cut);
+
+		// random mutations
+		int mutations = 1 + rng() % 8;
+		for(int i = 0; i < mutations && len > 0; i++) {
+			size_t at = rng() % len;
+			switch(rng() % 4) {
+				case 0: stream[at] = rng(); break;
+				case 1: stream[at] = "\r\n :?\t\0"[rng() % 7]; break;
+				case 2:
+					if(len < STREAM_MAX - 1) {
+						memmove(stream + at + 1, stream + at, len - at);
+						stream[at] = rng();
+						len++;
+					}
+					break;
+				default:
+					memmove(stream + at, stream + at + 1, len - at - 1);
+					len--;
+					break;
+			}
+		}
+		parse_stream(stream, len, 0, &whole);
+		parse_stream(stream, len, 1 + rng() % 16, &split);
+		if(!stream_equal(&whole, &split)) fuzz_fail("segments change the result (mutated)", stream, len);
+		if(whole.count > 0 && whole.results[whole.count - 1].status == HTTP_PARSER_ERROR) mutated_errors++;
+	}
+	printf("fuzz: %d iterations passed, %d mutated streams rejected\n", iterations, mutated_errors);
+}
+
+int main(int argc, char *argv[]) {
+
+	int count = 1000000;
+	int iterations = 100000;
+	int opt;
+
+	while((opt = getopt(argc, argv, "n:f:s:")) != -1) {
+		switch(opt) {
+			case 'n': count = atoi(optarg); break;
+			case 'f': iterations = atoi(optarg); break;
+			case 's': rng_state = strtoul(optarg, NULL, 0) | 1; break;
+			default:
+				fprintf(stderr, "usage: %s [-n requests] [-f iterations] [-s seed]\n", argv[0]);
+				return 1;
+		}
+	}
+
+	for(int i = 0; i < PATH_COUNT; i++) request_lens[i] = sprintf(requests[i], request_fmt, paths[i]);
+	if(http_router_init(&router, routes, sizeof(routes) / sizeof(routes[0]), route_handler) < 0) return 1;
+
+	if(count > 0) {
+		double bytes = 0;
+		for(int n = 0; n < PATH_COUNT; n++) bytes += request_lens[n];
+		printf("%d requests of %.0f bytes on average\n\n", count, bytes / PATH_COUNT);
+		printf("%-14s %12s %12s\n", "", "requests/s", "MB/s");
+		bytes *= (double)count / PATH_COUNT;
+
+		double ms[3];
+		ms[0] = bench_legacy(count);
+		ms[1] = bench_parser(count, 0);
+		ms[2] = bench_parser(count, 64);
+		const char *names[3] = { "strtok", "parser", "parser/seg64" };
+		for(int i = 0; i < 3; i++) {
+			printf("%-14s %12.0f %12.1f\n", names[i], count / ms[i] * 1000.0, bytes / ms[i] / 1000.0);
+		}
+		printf("\n");
+	}
+
+	if(iterations > 0) fuzz(iterations);
+	return 0;
+}
@@ -0,0 +1,67 @@
+/*
+ * Host build: lwIP netconn API on BSD sockets
+ *
+ * A netbuf holds the data of one recv() call of at most one TCP segment,
+ * so requests arrive split like on the ESP32.
+ */
+
+#ifndef HOST_LWIP_API_H_
+#define HOST_LWIP_API_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int8_t err_t;
+typedef uint8_t u8_t;
+typedef uint16_t u16_t;
+typedef uint32_t u32_t;
+
+#define ERR_OK			0
+#define ERR_MEM			-1
+#define ERR_TIMEOUT		-3
+#define ERR_VAL			-6
+#define ERR_CONN		-11
+#define ERR_RST			-14
+#define ERR_CLSD		-15
+
+#define NETCONN_NOFLAG	0x00
+#define NETCONN_NOCOPY	0x00
+#define NETCONN_COPY	0x01
+#define NETCONN_MORE	0x02
+
+#define NETCONN_TCP		0x10
+
+#define HOST_NETBUF_SIZE 1460
+
+struct netconn {
+	int fd;
+	int recv_timeout;		// ms, 0 waits forever
+};
+
+struct netbuf {
+	u16_t len;
+	char data[HOST_NETBUF_SIZE];
+};
+
+// the port bound instead of port 80, a non privileged port on the host
+extern u16_t host_netconn_http_port;
+
+// delay of every netconn_write in us, emulates a slow link
+extern uint32_t host_netconn_write_delay_us;
+
+struct netconn *netconn_new(int type);
+err_t netconn_bind(struct netconn *conn, const void *addr, u16_t port);
+err_t netconn_listen(struct netconn *conn);
+err_t netconn_accept(struct netconn *conn, struct netconn **new_conn);
+err_t netconn_recv(struct netconn *conn, struct netbuf **buf);
+err_t netconn_write(struct netconn *conn, const void *data, size_t size, u8_t flags);
+err_t netconn_close(struct netconn *conn);
+err_t netconn_delete(struct netconn *conn);
+
+err_t netbuf_data(struct netbuf *buf, void **data, u16_t *len);
+int8_t netbuf_next(struct netbuf *buf);
+void netbuf_delete(struct netbuf *buf);
+
+#define netconn_set_recvtimeout(conn, timeout) ((conn)->recv_timeout = (timeout))
+
+#endif /* HOST_LWIP_API_H_ */
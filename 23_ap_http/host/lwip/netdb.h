@@ -0,0 +1 @@
+/* Host build: see api.h */
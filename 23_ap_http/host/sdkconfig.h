@@ -0,0 +1,10 @@
+/*
+ * Host build: menuconfig values used by main.c
+ */
+
+#define CONFIG_AP_SSID "esp32-ap"
+#define CONFIG_AP_PASSWORD ""
+#define CONFIG_AP_CHANNEL 0
+#define CONFIG_WIFI_AUTH_OPEN 1
+#define CONFIG_AP_MAX_CONNECTIONS 4
+#define CONFIG_AP_BEACON_INTERVAL 100
@@ -1,8 +1,14 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "esp_system.h"
 #include "esp_wifi.h"
 #include "esp_event_loop.h"
@@ -15,6 +21,7 @@
 #include "esp_vfs.h"
 #include "esp_vfs_fat.h"
 #include "spiffs_vfs.h"
+#include "http_parser.h"
 
 
 // set AP CONFIG values
@@ -42,9 +49,115 @@
 	#define CONFIG_AP_AUTHMODE WIFI_AUTH_WPA2_ENTERPRISE
 #endif
 
+// HTTP server settings
+#ifdef CONFIG_HTTP_WORKERS
+	#define HTTP_WORKERS CONFIG_HTTP_WORKERS
+#else
+	#define HTTP_WORKERS 6
+#endif
+#ifdef CONFIG_HTTP_MAX_CLIENTS
+	#define HTTP_MAX_CLIENTS CONFIG_HTTP_MAX_CLIENTS
+#else
+	#define HTTP_MAX_CLIENTS 12
+#endif
+#define HTTP_KEEPALIVE_MS 5000
+#define HTTP_POLL_MS 20
+#define HTTP_MAX_REQUESTS 100
+
+// static content engine settings
+#ifdef CONFIG_HTTP_SEND_BUFFER_SIZE
+	#define HTTP_SEND_BUFFER_SIZE CONFIG_HTTP_SEND_BUFFER_SIZE
+#else
+	#define HTTP_SEND_BUFFER_SIZE 2920
+#endif
+#ifdef CONFIG_HTTP_SEND_BUFFERS
+	#define HTTP_SEND_BUFFERS CONFIG_HTTP_SEND_BUFFERS
+#else
+	#define HTTP_SEND_BUFFERS 4
+#endif
+#ifdef CONFIG_HTTP_FILE_CACHE_ENTRIES
+	#define HTTP_FILE_CACHE_ENTRIES CONFIG_HTTP_FILE_CACHE_ENTRIES
+#else
+	#define HTTP_FILE_CACHE_ENTRIES 16
+#endif
+#define HTTP_RESOURCE_MAX 64
+
 // static headers for HTTP responses
-const static char http_html_hdr[] = "HTTP/1.1 200 OK\n\n";
-const static char http_404_hdr[] = "HTTP/1.1 404 NOT FOUND\n\n";
+const static char http_404_hdr[] = "HTTP/1.1 404 Not Found\r\nContent-Type: text/html\r\nContent-Length: 22\r\nConnection: %s\r\n\r\n<h1>404 Not Found</h1>";
+const static char http_405_hdr[] = "HTTP/1.1 405 Method Not Allowed\r\nAllow: GET, HEAD\r\nContent-Length: 0\r\nConnection: %s\r\n\r\n";
+const static char http_503_hdr[] = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+const static char http_error_hdr[] = "HTTP/1.1 %s\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+// request headers used by the static content engine
+enum {
+	CAPTURE_IF_NONE_MATCH = 0,
+	CAPTURE_ACCEPT_ENCODING,
+	CAPTURE_COUNT,
+};
+const static char * const http_capture[CAPTURE_COUNT] = { "If-None-Match", "Accept-Encoding" };
+
+// one variant (plain or pre-gzipped) of a static file
+typedef struct {
+	int32_t size;		// -1 if the file doesn't exist
+	uint32_t etag;		// FNV-1a hash of the content
+} static_variant_t;
+
+// cached metadata of a static resource, the SPIFFS content is read-only
+typedef struct {
+	char resource[HTTP_RESOURCE_MAX];
+	static_variant_t plain;
+	static_variant_t gz;
+	uint32_t last_use;
+} static_file_t;
+
+// MIME types by file extension
+typedef struct {
+	const char *ext;
+	const char *type;
+} mime_type_t;
+
+const static mime_type_t mime_types[] = {
+	{ "html", "text/html" },
+	{ "htm", "text/html" },
+	{ "css", "text/css" },
+	{ "js", "application/javascript" },
+	{ "json", "application/json" },
+	{ "txt", "text/plain" },
+	{ "xml", "text/xml" },
+	{ "png", "image/png" },
+	{ "jpg", "image/jpeg" },
+	{ "jpeg", "image/jpeg" },
+	{ "gif", "image/gif" },
+	{ "ico", "image/x-icon" },
+	{ "svg", "image/svg+xml" },
+	{ "woff", "font/woff" },
+	{ "woff2", "font/woff2" },
+	{ NULL, "application/octet-stream" },
+};
+
+// send buffers, taken from and given back to the free queue
+static char send_buffer_mem[HTTP_SEND_BUFFERS][HTTP_SEND_BUFFER_SIZE];
+static QueueHandle_t send_buffers;
+
+// static file metadata cache
+static static_file_t file_cache[HTTP_FILE_CACHE_ENTRIES];
+static uint32_t file_cache_clock = 0;
+static SemaphoreHandle_t file_cache_mutex;
+
+// accepted connections waiting for a worker, and the bound on connected clients
+static QueueHandle_t conn_queue;
+static SemaphoreHandle_t client_slots;
+
+// per-worker request parsers
+static http_parser_t parsers[HTTP_WORKERS];
+
+// route table, the other resources are static files
+static int index_handler(http_parser_t *request, void *ctx);
+static int static_handler(http_parser_t *request, void *ctx);
+const static http_route_t routes[] = {
+	{ HTTP_METHOD_ANY, "/", index_handler },
+};
+static http_router_t router;
 
 // Event group
 static EventGroupHandle_t event_group;
@@ -54,8 +167,10 @@ const int STA_CONNECTED_BIT = BIT0;
 static esp_err_t event_handler(void *ctx, system_event_t *event);
 void ap_monitor_task(void *pvParameter);
 static void http_server(void *pvParameters);
-static void http_server_netconn_serve(struct netconn *conn);
-void spiffs_serve(char* resource, struct netconn *conn);
+static void http_worker(void *pvParameters);
+static void http_server_netconn_serve(struct netconn *conn, http_parser_t *parser);
+static void static_content_init(void);
+static int spiffs_serve(struct netconn *conn, http_parser_t *request, const char *resource);
 
 
 // AP event handler
@@ -74,7 +189,7 @@ static esp_err_t event_handler(void *ctx, system_event_t *event) {
 		printf("- mDNS service started\n");
 		
 		// start the HTTP server task
-		xTaskCreate(&http_server, "http_server", 20000, NULL, 5, NULL);
+		xTaskCreate(&http_server, "http_server", 2048, NULL, 5, NULL);
 		printf("- HTTP server started\n");
 
 		break;
@@ -103,11 +218,21 @@ void ap_monitor_task(void *pvParameter) {
 }
 
 
-// HTTP server task
+// HTTP server task, accepts the connections and queues them for the workers
 static void http_server(void *pvParameters) {
 	
 	struct netconn *conn, *newconn;
 	err_t err;
+	
+	// build the route table and start the workers
+	http_router_init(&router, routes, sizeof(routes) / sizeof(routes[0]), static_handler);
+	conn_queue = xQueueCreate(HTTP_MAX_CLIENTS, sizeof(struct netconn *));
+	client_slots = xSemaphoreCreateCounting(HTTP_MAX_CLIENTS, HTTP_MAX_CLIENTS);
+	for(int i = 0; i < HTTP_WORKERS; i++) {
+		http_parser_init(&parsers[i], http_capture, CAPTURE_COUNT);
+		xTaskCreate(&http_worker, "http_worker", 4096, &parsers[i], 5, NULL);
+	}
+	
 	conn = netconn_new(NETCONN_TCP);
 	netconn_bind(conn, NULL, 80);
 	netconn_listen(conn);
@@ -115,90 +240,290 @@ static void http_server(void *pvParameters) {
 	do {
 		err = netconn_accept(conn, &newconn);
 		if (err == ERR_OK) {
-			http_server_netconn_serve(newconn);
-			netconn_delete(newconn);
+			
+			// too many clients, refuse the connection
+			if(xSemaphoreTake(client_slots, 0) != pdTRUE) {
+				printf("Too many clients\n");
+				netconn_write(newconn, http_503_hdr, sizeof(http_503_hdr) - 1, NETCONN_NOCOPY);
+				netconn_close(newconn);
+				netconn_delete(newconn);
+				continue;
+			}
+			xQueueSend(conn_queue, &newconn, portMAX_DELAY);
 		}
-		vTaskDelay(10);
 	} while(err == ERR_OK);
 	netconn_close(conn);
 	netconn_delete(conn);
 }
 
-static void http_server_netconn_serve(struct netconn *conn) {
+// HTTP worker task, serves the connections from the queue
+static void http_worker(void *pvParameters) {
+	
+	http_parser_t *parser = (http_parser_t *)pvParameters;
+	struct netconn *conn;
+	
+	while(1) {
+		
+		xQueueReceive(conn_queue, &conn, portMAX_DELAY);
+		http_server_netconn_serve(conn, parser);
+		
+		// close the connection and free the client slot
+		netconn_close(conn);
+		netconn_delete(conn);
+		xSemaphoreGive(client_slots);
+	}
+}
+
+// default page -> index.html
+static int index_handler(http_parser_t *request, void *ctx) {
+	
+	return spiffs_serve((struct netconn *)ctx, request, "/index.html");
+}
+
+// static content, get it from SPIFFS
+static int static_handler(http_parser_t *request, void *ctx) {
+	
+	return spiffs_serve((struct netconn *)ctx, request, request->path);
+}
+
+// serve the requests of a connection, until it's closed or idle
+static void http_server_netconn_serve(struct netconn *conn, http_parser_t *parser) {
 
 	struct netbuf *inbuf;
-	char *buf;
-	u16_t buflen;
+	int keep_alive = 1;
+	int requests = 0;
+	int idle_ms = 0;
 	err_t err;
 
-	err = netconn_recv(conn, &inbuf);
-
-	if (err == ERR_OK) {
-	  
-		// get the request and terminate the string
-		netbuf_data(inbuf, (void**)&buf, &buflen);
-		buf[buflen] = '\0';
-		
-		// get the request body and the first line
-		char* body = strstr(buf, "\r\n\r\n");
-		char *request_line = strtok(buf, "\n");
+	http_parser_reset(parser);
+	netconn_set_recvtimeout(conn, HTTP_POLL_MS);
+	
+	while(keep_alive) {
 		
-		if(request_line) {
+		err = netconn_recv(conn, &inbuf);
+		if(err == ERR_TIMEOUT) {
 			
-			// default page -> redirect to index.html
-			if(strstr(request_line, "GET / ")) {
-				spiffs_serve("/index.html", conn);
-			}
-			// static content, get it from SPIFFS
-			else {
+			// an idle connection gives the worker to waiting clients
+			idle_ms += HTTP_POLL_MS;
+			if((!http_parser_started(parser) && uxQueueMessagesWaiting(conn_queue) > 0) || idle_ms >= HTTP_KEEPALIVE_MS) return;
+			continue;
+		}
+		if(err != ERR_OK) return;
+		idle_ms = 0;
+		
+		// parse the received data in place, a request may span more netbufs
+		// and a netbuf may contain more (pipelined) requests
+		do {
+			void *data;
+			u16_t data_len;
+			netbuf_data(inbuf, &data, &data_len);
+			const char *next = data;
+			size_t left = data_len;
+			while(keep_alive && left > 0) {
+				
+				size_t consumed;
+				http_parser_status_t status = http_parser_feed(parser, next, left, &consumed);
+				next += consumed;
+				left -= consumed;
 				
-				// get the requested resource
-				char* method = strtok(request_line, " ");
-				char* resource = strtok(NULL, " ");
-				spiffs_serve(resource, conn);
+				if(status == HTTP_PARSER_DONE) {
+					keep_alive = http_router_dispatch(&router, parser, conn) && ++requests < HTTP_MAX_REQUESTS;
+					http_parser_reset(parser);
+				}
+				else if(status == HTTP_PARSER_ERROR) {
+					char response[96];
+					int len = sprintf(response, http_error_hdr, http_parser_error_status(parser->error));
+					netconn_write(conn, response, len, NETCONN_COPY);
+					keep_alive = 0;
+				}
 			}
+		} while(keep_alive && netbuf_next(inbuf) >= 0);
+		netbuf_delete(inbuf);
+	}
+}
+
+// get the MIME type of a resource from its extension
+static const char *http_mime_type(const char *resource) {
+	
+	const char *ext = strrchr(resource, '.');
+	const mime_type_t *mime = mime_types;
+	if(ext) {
+		ext++;
+		for(; mime->ext; mime++) {
+			if(strcasecmp(ext, mime->ext) == 0) break;
 		}
 	}
+	else {
+		while(mime->ext) mime++;
+	}
+	return mime->type;
 }
 
-// serve static content from SPIFFS
-void spiffs_serve(char* resource, struct netconn *conn) {
-						
-	// check if it exists on SPIFFS
-	char full_path[100];
-	sprintf(full_path, "/spiffs%s", resource);
-	printf("+ Serving static resource: %s\n", full_path);
-	struct stat st;
-	if (stat(full_path, &st) == 0) {
-		netconn_write(conn, http_html_hdr, sizeof(http_html_hdr) - 1, NETCONN_NOCOPY);
-		
-		// open the file for reading
-		FILE* f = fopen(full_path, "r");
-		if(f == NULL) {
-			printf("Unable to open the file %s\n", full_path);
-			return;
+// read a file once to get its size and ETag
+static void static_variant_load(const char *path, static_variant_t *variant, char *buffer) {
+	
+	variant->size = -1;
+	variant->etag = 0;
+	int fd = open(path, O_RDONLY);
+	if(fd < 0) return;
+	
+	uint32_t hash = 2166136261u;
+	int32_t size = 0;
+	int len;
+	while((len = read(fd, buffer, HTTP_SEND_BUFFER_SIZE)) > 0) {
+		for(int i = 0; i < len; i++) hash = (hash ^ (uint8_t)buffer[i]) * 16777619u;
+		size += len;
+	}
+	close(fd);
+	variant->size = size;
+	variant->etag = hash;
+}
+
+// get the metadata of a resource, from the cache or from SPIFFS
+static void static_file_lookup(const char *resource, static_file_t *file, char *buffer) {
+	
+	xSemaphoreTake(file_cache_mutex, portMAX_DELAY);
+	
+	static_file_t *entry = NULL;
+	static_file_t *oldest = &file_cache[0];
+	for(int i = 0; i < HTTP_FILE_CACHE_ENTRIES; i++) {
+		if(strcmp(file_cache[i].resource, resource) == 0) {
+			entry = &file_cache[i];
+			break;
 		}
+		if(file_cache[i].last_use < oldest->last_use) oldest = &file_cache[i];
+	}
+	
+	// not cached, replace the least recently used entry
+	if(!entry) {
+		char path[HTTP_RESOURCE_MAX + 16];
+		entry = oldest;
+		strcpy(entry->resource, resource);
+		sprintf(path, "/spiffs%s", resource);
+		static_variant_load(path, &entry->plain, buffer);
+		strcat(path, ".gz");
+		static_variant_load(path, &entry->gz, buffer);
+	}
+	entry->last_use = ++file_cache_clock;
+	*file = *entry;
+	
+	xSemaphoreGive(file_cache_mutex);
+}
+
+// serve static content from SPIFFS, returns 1 if the connection can be kept open
+static int spiffs_serve(struct netconn *conn, http_parser_t *request, const char *resource) {
+	
+	int keep_alive = request->keep_alive;
+	const char *connection = keep_alive ? "keep-alive" : "close";
+	printf("+ Serving static resource: %s\n", resource);
+	
+	// get a send buffer, it's also used to load the file metadata
+	char *buffer;
+	xQueueReceive(send_buffers, &buffer, portMAX_DELAY);
+	
+	// static files can only be read
+	if(request->method != HTTP_METHOD_GET && request->method != HTTP_METHOD_HEAD) {
+		int len = sprintf(buffer, http_405_hdr, connection);
+		netconn_write(conn, buffer, len, NETCONN_COPY);
+		xQueueSend(send_buffers, &buffer, portMAX_DELAY);
+		return keep_alive;
+	}
+	
+	if(strlen(resource) >= HTTP_RESOURCE_MAX) {
+		int len = sprintf(buffer, http_404_hdr, connection);
+		netconn_write(conn, buffer, len, NETCONN_COPY);
+		xQueueSend(send_buffers, &buffer, portMAX_DELAY);
+		return keep_alive;
+	}
+	
+	static_file_t file;
+	static_file_lookup(resource, &file, buffer);
+	
+	// prefer the pre-gzipped variant if the client accepts it
+	int gzip = 0;
+	if(file.gz.size >= 0 && (file.plain.size < 0 ||
+			strstr(http_parser_value(request, CAPTURE_ACCEPT_ENCODING), "gzip"))) {
+		gzip = 1;
+	}
+	static_variant_t *variant = gzip ? &file.gz : &file.plain;
+	
+	if(variant->size < 0) {
+		int len = sprintf(buffer, http_404_hdr, connection);
+		netconn_write(conn, buffer, len, NETCONN_COPY);
+		xQueueSend(send_buffers, &buffer, portMAX_DELAY);
+		return keep_alive;
+	}
+	
+	// the client has a valid copy
+	char etag[12];
+	sprintf(etag, "\"%08x\"", (unsigned int)variant->etag);
+	if(strstr(http_parser_value(request, CAPTURE_IF_NONE_MATCH), etag)) {
+		int len = sprintf(buffer, "HTTP/1.1 304 Not Modified\r\nETag: %s\r\nConnection: %s\r\n\r\n", etag, connection);
+		netconn_write(conn, buffer, len, NETCONN_COPY);
+		xQueueSend(send_buffers, &buffer, portMAX_DELAY);
+		return keep_alive;
+	}
+	
+	int len = sprintf(buffer,
+		"HTTP/1.1 200 OK\r\n"
+		"Content-Type: %s\r\n"
+		"Content-Length: %d\r\n"
+		"ETag: %s\r\n"
+		"Cache-Control: no-cache\r\n"
+		"%s%s"
+		"Connection: %s\r\n\r\n",
+		http_mime_type(resource), (int)variant->size, etag,
+		gzip ? "Content-Encoding: gzip\r\n" : "",
+		file.gz.size >= 0 ? "Vary: Accept-Encoding\r\n" : "",
+		connection);
+	
+	int fd = -1;
+	int32_t left = 0;
+	int32_t sent = 0;
+	if(request->method != HTTP_METHOD_HEAD) {
+		char path[HTTP_RESOURCE_MAX + 16];
+		sprintf(path, gzip ? "/spiffs%s.gz" : "/spiffs%s", resource);
+		fd = open(path, O_RDONLY);
+		if(fd >= 0) left = variant->size;
 		
-		// send the file content to the client
-		char buffer[500];
-		int size = 0;
-		/*while(fgets(buffer, 500, f)) {
-			netconn_write(conn, buffer, strlen(buffer), NETCONN_NOCOPY);
-		}*/
-		while(!feof(f)) {
-			
-			size_t char_read;
-			char_read = fread(buffer, sizeof(char), 500, f);
-			size += char_read / sizeof(char);
-			netconn_write(conn, buffer, char_read / sizeof(char), NETCONN_NOCOPY);	
-		}
-		fclose(f);
-		fflush(stdout);
-		printf("+ served %d bytes\n", size);
+		// without the body the connection can't be reused
+		else keep_alive = 0;
 	}
-	else {
-		netconn_write(conn, http_404_hdr, sizeof(http_404_hdr) - 1, NETCONN_NOCOPY);
+	
+	// send the headers together with the first chunk of the file, NETCONN_COPY
+	// returns when lwIP has queued the data, so the buffer can be refilled
+	err_t err = ERR_OK;
+	do {
+		int chunk = HTTP_SEND_BUFFER_SIZE - len;
+		if(chunk > left) chunk = left;
+		if(chunk > 0) {
+			chunk = read(fd, buffer + len, chunk);
+			if(chunk <= 0) break;
+			left -= chunk;
+			sent += chunk;
+			len += chunk;
+		}
+		err = netconn_write(conn, buffer, len, NETCONN_COPY | (left > 0 ? NETCONN_MORE : 0));
+		len = 0;
+	} while(err == ERR_OK && left > 0);
+	
+	if(fd >= 0) close(fd);
+	xQueueSend(send_buffers, &buffer, portMAX_DELAY);
+	printf("+ served %d bytes%s\n", (int)sent, gzip ? " (gzip)" : "");
+	
+	// a short response breaks the framing of the next one
+	return keep_alive && err == ERR_OK && left == 0;
+}
+
+// initialize the send buffers and the file cache
+static void static_content_init(void) {
+	
+	send_buffers = xQueueCreate(HTTP_SEND_BUFFERS, sizeof(char *));
+	for(int i = 0; i < HTTP_SEND_BUFFERS; i++) {
+		char *buffer = send_buffer_mem[i];
+		xQueueSend(send_buffers, &buffer, 0);
 	}
+	file_cache_mutex = xSemaphoreCreateMutex();
 }
 
 // Main application
@@ -220,6 +545,10 @@ void app_main()
 	// initialize SPIFFS
 	vfs_spiffs_register();
 	printf("- SPIFFS VFS module registered\n");
+	
+	// initialize the static content engine
+	static_content_init();
+	printf("- Static content engine initialized\n");
 		
 	// initialize the tcp stack
 	tcpip_adapter_init();